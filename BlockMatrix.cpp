@@ -2,11 +2,13 @@
 #include <fstream>
 #include <time.h>
 #include <cmath>
+#include <vector>
 
 using std::endl;
 using std::ostream;
 using std::ofstream;
 using std::ifstream;
+using std::vector;
 
 #include "include.h"
 
@@ -63,6 +65,40 @@ BlockMatrix::BlockMatrix(const BlockMatrix &blockmat_copy){
 
 }
 
+/**
+ * move constructor: the blocks of blockmat_move are taken over without copying. blockmat_move keeps its dimensions and
+ * degeneracies but no allocated blocks, so it can only be destructed or assigned to: a copy assignment allocates new blocks.
+ * @param blockmat_move The blockmatrix whose blocks are taken
+ */
+BlockMatrix::BlockMatrix(BlockMatrix &&blockmat_move){
+
+   this->nr = blockmat_move.nr;
+
+   blockmatrix = new Matrix * [nr];
+
+   dim = new int [nr];
+
+   flag = new int [nr];
+
+   degen = new int [nr];
+
+   for(int i = 0;i < nr;++i){
+
+      flag[i] = blockmat_move.flag[i];
+
+      degen[i] = blockmat_move.degen[i];
+
+      dim[i] = blockmat_move.dim[i];
+
+      blockmatrix[i] = blockmat_move.blockmatrix[i];
+
+      blockmat_move.blockmatrix[i] = 0;
+      blockmat_move.flag[i] = 0;
+
+   }
+
+}
+
 /**
  * Destructor
  */
@@ -124,17 +160,98 @@ const Matrix &BlockMatrix::operator[](int block) const{
 
 /**
  * overload the equality operator: Make sure the blocks in both matrices have been allocated to the same dimensions and have the same degeneracy!
+ * Blocks that are not allocated, e.g. after a move, are allocated as copies of the blocks of blockmat_copy.
  * @param blockmat_copy The matrix you want to be copied into this
  */
 BlockMatrix &BlockMatrix::operator=(const BlockMatrix &blockmat_copy){
 
-   for(int i = 0;i < nr;++i)
-      *blockmatrix[i] = blockmat_copy[i];
+   for(int i = 0;i < nr;++i){
+
+      if(flag[i] == 0){
+
+         flag[i] = 1;
+
+         dim[i] = blockmat_copy.gdim(i);
+
+         degen[i] = blockmat_copy.gdeg(i);
+
+         blockmatrix[i] = new Matrix(blockmat_copy[i]);
+
+      }
+      else
+         *blockmatrix[i] = blockmat_copy[i];
+
+   }
 
    return *this;
 
 }
 
+/**
+ * move assignment: swaps the blocks of (*this) and blockmat_move, no numbers are copied
+ * @param blockmat_move The blockmatrix you want to be moved into this
+ */
+BlockMatrix &BlockMatrix::operator=(BlockMatrix &&blockmat_move){
+
+   this->swap(blockmat_move);
+
+   return *this;
+
+}
+
+/**
+ * Evaluate the linear combination coef[0] term[0] + ... + coef[K-1] term[K-1] into (*this) block by block, see Matrix::lincomb
+ * @param K number of terms
+ * @param coef the coefficients
+ * @param term the terms, blockmatrices with the same block structure as (*this)
+ */
+BlockMatrix &BlockMatrix::lincomb(int K,const double *coef,const BlockMatrix * const *term){
+
+   const Matrix **term_i = new const Matrix * [K + 1];
+
+   for(int i = 0;i < nr;++i){
+
+      for(int k = 0;k < K;++k)
+         term_i[k] = term[k]->blockmatrix[i];
+
+      blockmatrix[i]->lincomb(K,coef,term_i);
+
+   }
+
+   delete [] term_i;
+
+   return *this;
+
+}
+
+/**
+ * Swap the content of (*this) and blockmat_sw by swapping the pointers to the blocks, O(1) in the size of the blocks
+ * @param blockmat_sw The blockmatrix to swap with
+ */
+void BlockMatrix::swap(BlockMatrix &blockmat_sw){
+
+   Matrix **hulp = blockmatrix;
+   blockmatrix = blockmat_sw.blockmatrix;
+   blockmat_sw.blockmatrix = hulp;
+
+   int *ihulp = dim;
+   dim = blockmat_sw.dim;
+   blockmat_sw.dim = ihulp;
+
+   ihulp = flag;
+   flag = blockmat_sw.flag;
+   blockmat_sw.flag = ihulp;
+
+   ihulp = degen;
+   degen = blockmat_sw.degen;
+   blockmat_sw.degen = ihulp;
+
+   int nr_hulp = nr;
+   nr = blockmat_sw.nr;
+   blockmat_sw.nr = nr_hulp;
+
+}
+
 /**
  * Make all the numbers in your blockmatrix equal to the number a, e.g. usefull for initialization (BlockMatrix M = 0)
  * @param a the number
@@ -393,11 +510,106 @@ void BlockMatrix::out(const char *filename) const{
 /**
  * Seperate SUP into two SUP's, a positive and negative semidefinite part.
  * @param p positive (plus) output part
- * @param m negative (minus) output part
+ * @param m negative (minus) output part, can be (*this) to store it in place
+ * @param single if true the blocks are diagonalized in single precision, see Matrix::sep_pm
+ * @param scale the minus part is returned multiplied with scale
+ * @param m_f if not 0, the factors of the blocks of the minus part are stored here, see Matrix::sep_pm
+ * @param n_def if not 0, n_def[2*i] is incremented when block i is positive definite and n_def[2*i + 1] when it is negative definite
+ * @param alone if false the blocks are separated by concurrent tasks, except those that run alone (see ThreadBudget::alone). If true only
+ * these are separated, one after the other, and no other task may call the BLAS at the same time.
+ */
+void BlockMatrix::sep_pm(BlockMatrix &p,BlockMatrix &m,bool single,double scale,LRBlockMatrix *m_f,long *n_def,bool alone){
+
+   //the blocks of this call: the blocks of this MPI rank (see Distribution) that run alone or not
+   vector<int> block,node;
+
+   for(int i = 0;i < nr;++i)
+      if(!blockmatrix[i]->gremote() && ThreadBudget::alone(dim[i]) == alone){
+
+         block.push_back(i);
+         node.push_back(blockmatrix[i]->gnode());
+
+      }
+
+   //the blocks are independent: every block is a task on the node of the block (see Numa::run) and writes only its own entries of n_def
+   auto work = [&](int b){
+
+      int i = block[b];
+
+      //the BLAS threads of this task, see ThreadBudget
+      ThreadBudget budget(dim[i]);
+
+      int def = blockmatrix[i]->sep_pm(p[i],m[i],single,scale,m_f ? &(*m_f)[i] : 0);
+
+      if(n_def != 0){
+
+         if(def == 1)
+            ++n_def[2*i];
+         else if(def == -1)
+            ++n_def[2*i + 1];
+
+      }
+
+   };
+
+   if(alone){
+
+      for(unsigned int b = 0;b < block.size();++b)
+         work(b);
+
+   }
+   else
+      Numa::run(block.size(),node.data(),work);
+
+}
+
+/**
+ * @return the number of blocks of this MPI rank that run alone in sep_pm, see ThreadBudget::alone
+ */
+int BlockMatrix::n_alone() const{
+
+   int ward = 0;
+
+   for(int i = 0;i < nr;++i)
+      if(!blockmatrix[i]->gremote() && ThreadBudget::alone(dim[i]))
+         ++ward;
+
+   return ward;
+
+}
+
+/**
+ * Replace (*this) by blockmatrix_in and return the squared distance between the old and the new (*this), see Matrix::update
+ * @param blockmatrix_in input blockmatrix, contains the old (*this) on exit
+ * @return the squared norm of (*this) - blockmatrix_in before the swap, with the degeneracies of the blocks taken into account
+ */
+double BlockMatrix::update(BlockMatrix &blockmatrix_in){
+
+   double ward = 0.0;
+
+   for(int i = 0;i < nr;++i)
+      ward += degen[i]*blockmatrix[i]->update(blockmatrix_in[i]);
+
+   return ward;
+
+}
+
+/**
+ * Hint that the blocks will be used soon, see Matrix::prefetch
+ */
+void BlockMatrix::prefetch() const{
+
+   for(int i = 0;i < nr;++i)
+      blockmatrix[i]->prefetch();
+
+}
+
+/**
+ * Hint that the blocks will not be used for a while, see Matrix::release
  */
-void BlockMatrix::sep_pm(BlockMatrix &p,BlockMatrix &m){
+void BlockMatrix::release() const{
 
    for(int i = 0;i < nr;++i)
-      blockmatrix[i]->sep_pm(p[i],m[i]);
+      blockmatrix[i]->release();
 
 }
@@ -0,0 +1,267 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <limits>
+
+using std::endl;
+using std::ostream;
+
+#include "include.h"
+
+/**
+ * constructor: Z and X start at zero, sigma at one
+ * @param ham_in the hamiltonian
+ * @param lowrank blocks of the primal matrix with rank up to this fraction of their dimension are stored factored, see LRSUP
+ * @param single the projections are done in single precision as long as one of the residuals is larger than this, and as long as they decrease
+ */
+BoundaryPoint::BoundaryPoint(const TPM &ham_in,double lowrank,double single) : ham(ham_in),ham_copy(ham_in),Z(ham_in.gM(),ham_in.gN()),
+   W(ham_in.gM(),ham_in.gN()),X(W,lowrank),V_f(W,lowrank),stats(W),u(ham_in.gM(),ham_in.gN()),hulp(ham_in.gM(),ham_in.gN()),
+   u_0_c(ham_in.gM(),ham_in.gN()),X_c(ham_in.gM(),ham_in.gN()),rhs(ham_in.gM(),ham_in.gN()),v(ham_in.gM(),ham_in.gN()){
+
+   M = ham_in.gM();
+   N = ham_in.gN();
+
+   //only traceless hamiltonian needed in program.
+   ham.proj_Tr();
+
+   Z = 0.0;
+
+   u.init();
+
+   //the affine projection only needs the collapsed u_0 and X: W = fill(S^-1(collaps(Z) + rhs) + u) with rhs constant during an outer iteration
+   u_0_c.S(1,u);
+   u_0_c.proj_Tr();
+
+   X_c = 0.0;
+
+   sigma = 1.0;
+
+   tolerance = 1.0e-7;
+
+   D_conv = 1.0;
+   P_conv = 1.0;
+   convergence = 1.0;
+
+   mazzy = 1.6;
+
+   max_iter = 1;
+
+   iter_primal = 0;
+
+   this->single = single;
+
+   use_single = (single > 0.0);
+
+   single_min = std::numeric_limits<double>::max();
+   single_stall = 0;
+
+   max_stall = 300;
+
+}
+
+/**
+ * Destructor
+ */
+BoundaryPoint::~BoundaryPoint(){ }
+
+/**
+ * One outer iteration: at most max_iter + 1 projections with the primal matrix fixed, then the primal update and the update of sigma
+ */
+void BoundaryPoint::outer(){
+
+   ++iter_primal;
+
+   D_conv = 1.0;
+
+   int iter_dual = 0;
+
+   //constant part of collaps(Z - u_0 + mazzy/sigma X) - mazzy/sigma ham
+   rhs = (mazzy/sigma)*X_c - (mazzy/sigma)*ham - u_0_c;
+
+   //and the trace of the collapsed V: u_0.ddot(V) = u.ddot(collaps(0,V)) = u(0,0) Tr collaps(0,V)
+   double v_tr = 0.0;
+
+   while(D_conv > tolerance  && iter_dual <= max_iter){
+
+      ++iter_dual;
+
+      //solve system and construct W = fill(hulp) - X/sigma, hulp is the matrix containing the gamma_i's, then update Z and
+      //V = -sigma W_- with eigenvalue decomposition, V is stored in W, and collaps V: one task graph over the blocks of W
+      W.proj_U_sep(Z,rhs,u,hulp,X,sigma,use_single,&V_f,&stats,v);
+
+      //check infeasibility of the primal problem:
+      v_tr = v.trace();
+
+      v.proj_Tr();
+
+      v -= ham;
+
+      D_conv = std::sqrt(v.ddot(v));
+
+   }
+
+   //update primal and check dual feasibility: W = Z + W_-, so fill(hulp) - Z = (X - V)/sigma, W is overwritten in the next projection.
+   //The blocks are updated and their distances calculated in tasks, see LRSUP::update
+   P_conv = std::sqrt(Distribution::sum(X.update(W,V_f)))/sigma;
+
+   X_c = v + ham;
+
+   //switch to double precision for good once both residuals approach the tolerance, or once they stop decreasing: the rounding of the
+   //single precision projections puts a floor under the residuals (about 5e-6 for the hubbard model), which may lie above the threshold
+   if(use_single){
+
+      double res = (P_conv > D_conv) ? P_conv : D_conv;
+
+      if(res < 0.99 * single_min){
+
+         single_min = res;
+         single_stall = 0;
+
+      }
+      else
+         ++single_stall;
+
+      if(res < single || single_stall >= max_stall)
+         use_single = false;
+
+   }
+
+   if(D_conv < P_conv)
+      sigma *= 1.01;
+   else
+      sigma /= 1.01;
+
+   convergence = Distribution::sum(ham.ddot(Z.tpm(0))) + u(0,0,0) * v_tr;
+
+}
+
+/**
+ * @return true if the residuals and the gap are below the tolerance, never when the solve has diverged
+ */
+bool BoundaryPoint::converged() const{
+
+   if(diverged())
+      return false;
+
+   return !(P_conv > tolerance || D_conv > tolerance || std::fabs(convergence) > tolerance);
+
+}
+
+/**
+ * @return true if a residual, the gap or sigma is no longer a finite number: the solve can't recover from that
+ */
+bool BoundaryPoint::diverged() const{
+
+   return !std::isfinite(P_conv) || !std::isfinite(D_conv) || !std::isfinite(convergence) || !std::isfinite(sigma);
+
+}
+
+/**
+ * @return the energy of the current dual Z
+ */
+double BoundaryPoint::energy() const{
+
+   return Distribution::sum(ham_copy.ddot(Z.tpm(0)));
+
+}
+
+/**
+ * @return the primal dual gap Tr (X Z)
+ */
+double BoundaryPoint::pd_gap() const{
+
+   return Distribution::sum(X.ddot(Z));
+
+}
+
+/**
+ * @return the primal residual of the last outer iteration
+ */
+double BoundaryPoint::gP_conv() const{
+
+   return P_conv;
+
+}
+
+/**
+ * @return the dual residual of the last outer iteration
+ */
+double BoundaryPoint::gD_conv() const{
+
+   return D_conv;
+
+}
+
+/**
+ * @return the penalty parameter
+ */
+double BoundaryPoint::gsigma() const{
+
+   return sigma;
+
+}
+
+/**
+ * @return the gap of the last outer iteration
+ */
+double BoundaryPoint::gconvergence() const{
+
+   return convergence;
+
+}
+
+/**
+ * @return the number of outer iterations
+ */
+int BoundaryPoint::giter() const{
+
+   return iter_primal;
+
+}
+
+/**
+ * @return true if the projections are still done in single precision
+ */
+bool BoundaryPoint::gsingle() const{
+
+   return use_single;
+
+}
+
+/**
+ * @return the dual SUP
+ */
+SUP &BoundaryPoint::gZ(){
+
+   return Z;
+
+}
+
+/**
+ * @return W, the Lagrange multiplier after a projection
+ */
+SUP &BoundaryPoint::gW(){
+
+   return W;
+
+}
+
+/**
+ * @return the primal SUP
+ */
+const LRSUP &BoundaryPoint::gX() const{
+
+   return X;
+
+}
+
+/**
+ * @return the statistics of the separations
+ */
+SepStats &BoundaryPoint::gstats(){
+
+   return stats;
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
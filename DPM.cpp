@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <utility>
 #include <cstdlib>
 #include <cmath>
 
@@ -29,13 +30,18 @@ DPM::DPM(int M,int N) : BlockMatrix(2) {
    this->M = M;
 
    //set the dimension and the degeneracies of the blocks
-   this->setMatrixDim(0,M/2*(M/2 - 1) + M/2*(M/2 - 1)*(M/2 - 2)/3,2);
-   this->setMatrixDim(1,M/2*(M/2 - 1)*(M/2 - 2)/6,4);
+   this->setMatrixDim(0,block_dim(M,0),2);
+   this->setMatrixDim(1,block_dim(M,1),4);
 
-   if(counter == 0)//make the lists
-      construct_lists();
+   #pragma omp critical(dpm_lists)
+   {
 
-   ++counter;
+      if(counter == 0)//make the lists
+         construct_lists();
+
+      ++counter;
+
+   }
 
 }
 
@@ -49,10 +55,36 @@ DPM::DPM(const DPM &dpm_c) : BlockMatrix(dpm_c) {
    this->N = dpm_c.gN();
    this->M = dpm_c.gM();
 
-   if(counter == 0)
-      construct_lists();
+   #pragma omp critical(dpm_lists)
+   {
+
+      if(counter == 0)
+         construct_lists();
 
-   ++counter;
+      ++counter;
+
+   }
+
+}
+
+/**
+ * move constructor: takes over the blocks of dpm_m without copying, see BlockMatrix(BlockMatrix &&)
+ * @param dpm_m object that will be moved into this.
+ */
+DPM::DPM(DPM &&dpm_m) : BlockMatrix(std::move(dpm_m)){
+
+   this->N = dpm_m.gN();
+   this->M = dpm_m.gM();
+
+   #pragma omp critical(dpm_lists)
+   {
+
+      if(counter == 0)
+         construct_lists();
+
+      ++counter;
+
+   }
 
 }
 
@@ -61,61 +93,78 @@ DPM::DPM(const DPM &dpm_c) : BlockMatrix(dpm_c) {
  */
 DPM::~DPM(){
 
-   if(counter == 1){
+   #pragma omp critical(dpm_lists)
+   {
 
-      //first delete S = 1/2 part
-      for(int S_ab = 0;S_ab < 2;++S_ab){
+      if(counter == 1){
 
-         for(int a = 0;a < M/2;++a){
+         //first delete S = 1/2 part
+         for(int S_ab = 0;S_ab < 2;++S_ab){
 
-            for(int b = 0;b < M/2;++b)
-               delete [] s2dp[0][S_ab][a][b];
+            for(int a = 0;a < M/2;++a){
+
+               for(int b = 0;b < M/2;++b)
+                  delete [] s2dp[0][S_ab][a][b];
 
-            delete [] s2dp[0][S_ab][a];
+               delete [] s2dp[0][S_ab][a];
+
+            }
+
+            delete [] s2dp[0][S_ab];
 
          }
 
-         delete [] s2dp[0][S_ab];
+         //then the S = 3/2 part
+         for(int a = 0;a < M/2;++a){
 
-      }
+            for(int b = 0;b < M/2;++b)
+               delete [] s2dp[1][0][a][b];
 
-      //then the S = 3/2 part
-      for(int a = 0;a < M/2;++a){
+            delete [] s2dp[1][0][a];
 
-         for(int b = 0;b < M/2;++b)
-            delete [] s2dp[1][0][a][b];
+         }
 
-         delete [] s2dp[1][0][a];
+         delete [] s2dp[1][0];
 
-      }
+         for(int S = 0;S < 2;++S)
+            delete [] s2dp[S];
 
-      delete [] s2dp[1][0];
+         delete [] s2dp;
 
-      for(int S = 0;S < 2;++S)
-         delete [] s2dp[S];
+         //now delete dp2s 
+         for(int S = 0;S < 2;++S){
 
-      delete [] s2dp;
+            for(int i = 0;i < this->gdim(S);++i)
+               delete [] dp2s[S][i];
 
-      //now delete dp2s 
-      for(int S = 0;S < 2;++S){
+                  delete [] dp2s[S];
 
-         for(int i = 0;i < this->gdim(S);++i)
-            delete [] dp2s[S][i];
+         }
 
-               delete [] dp2s[S];
+         delete [] dp2s;
 
-      }
+         for(int S = 0;S < 2;++S)
+            delete [] _6j[S];
 
-      delete [] dp2s;
+         delete [] _6j;
 
-      for(int S = 0;S < 2;++S)
-         delete [] _6j[S];
+      }
 
-      delete [] _6j;
+      --counter;
 
    }
 
-   --counter;
+}
+
+/**
+ * move assignment: swaps the blocks of (*this) and dpm_m, no numbers are copied
+ * @param dpm_m object that will be moved into this.
+ */
+DPM &DPM::operator=(DPM &&dpm_m){
+
+   this->swap(dpm_m);
+
+   return *this;
 
 }
 
@@ -550,17 +599,36 @@ void DPM::T(double A,double B,double C,const TPM &tpm){
 
    double ward = 2.0*B*tpm.trace();
 
-   int a,b,c,d,e,z;
-   int S_ab,S_de;
+   this->T(A,ward,spm,tpm);
+
+}
+
+/**
+ * The spincoupled T1-like map with the np and sp part already calculated, see SUP::fill.
+ * @param A term before the tp part of the map
+ * @param ward the np part: B times twice the trace of tpm
+ * @param spm the sp part: the SPM of tpm scaled with C
+ * @param tpm input TPM
+ */
+void DPM::T(double A,double ward,const SPM &spm,const TPM &tpm){
+
+   //the blocks of other MPI ranks are not filled, see Distribution
+   int rows[2];
+
+   for(int S = 0;S < 2;++S)
+      rows[S] = (*this)[S].gremote() ? 0 : this->gdim(S);
+
+   //start with the S = 1/2 block, this is the most difficult one: every row is a task on the node of the block, see Numa::run
+   Numa::run(rows[0],(*this)[0].gnode(),[&](int i){
 
-   int sign_ab,sign_de;
+      int a,b,c,d,e,z;
+      int S_ab,S_de;
 
-   double norm_ab,norm_de;
+      int sign_ab,sign_de;
 
-   double hard;
+      double norm_ab,norm_de;
 
-   //start with the S = 1/2 block, this is the most difficult one:
-   for(int i = 0;i < this->gdim(0);++i){
+      double hard;
 
       S_ab = dp2s[0][i][0];
 
@@ -795,11 +863,13 @@ void DPM::T(double A,double B,double C,const TPM &tpm){
          }
 
       }
-   }
+   });
 
 
    //then the S = 3/2 block, this should be easy, totally antisymmetrical 
-   for(int i = 0;i < this->gdim(1);++i){
+   Numa::run(rows[1],(*this)[1].gnode(),[&](int i){
+
+      int a,b,c,d,e,z;
 
       a = dp2s[1][i][1];
       b = dp2s[1][i][2];
@@ -897,7 +967,7 @@ void DPM::T(double A,double B,double C,const TPM &tpm){
             (*this)(1,i,j) += A * tpm(1,b,c,e,z);
 
       }
-   }
+   });
 
    this->symmetrize();
 
@@ -998,3 +1068,18 @@ void DPM::in_sp(const char *filename){
    this->symmetrize();
 
 }
+
+/**
+ * The dimensions of the blocks of a DPM, without constructing one (used to estimate the memory use of a run)
+ * @param M dimension of sp space
+ * @param i the block index: 0 or 1 for the S=1/2 and S=3/2 block
+ * @return the dimension of block i
+ */
+int DPM::block_dim(int M,int i){
+
+   if(i == 0)
+      return M/2*(M/2 - 1) + M/2*(M/2 - 1)*(M/2 - 2)/3;
+   else
+      return M/2*(M/2 - 1)*(M/2 - 2)/6;
+
+}
@@ -0,0 +1,250 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#ifdef __MPI
+#include <mpi.h>
+#endif
+
+using std::endl;
+using std::ostream;
+using std::vector;
+
+#include "include.h"
+
+int Distribution::rank = 0;
+int Distribution::size = 1;
+
+vector<double> Distribution::load;
+vector<int> Distribution::n_blocks;
+
+/**
+ * Initialize MPI. The iterations run in an OpenMP single region, so MPI is called from one thread at a time, but not always the same one.
+ * @param argc pointer to the number of arguments of main
+ * @param argv pointer to the arguments of main
+ */
+void Distribution::init(int *argc,char ***argv){
+
+#ifdef __MPI
+
+   int provided;
+
+   MPI_Init_thread(argc,argv,MPI_THREAD_SERIALIZED,&provided);
+
+   MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+   MPI_Comm_size(MPI_COMM_WORLD,&size);
+
+   if(provided < MPI_THREAD_SERIALIZED && rank == 0)
+      std::cerr << "Distribution: the MPI library doesn't support MPI_THREAD_SERIALIZED, run with one thread per rank" << endl;
+
+#endif
+
+}
+
+/**
+ * Finalize MPI
+ */
+void Distribution::finalize(){
+
+#ifdef __MPI
+
+   MPI_Finalize();
+
+#endif
+
+}
+
+/**
+ * @return the rank of this process, 0 without MPI
+ */
+int Distribution::grank(){
+
+   return rank;
+
+}
+
+/**
+ * @return the number of ranks, 1 without MPI
+ */
+int Distribution::gsize(){
+
+   return size;
+
+}
+
+/**
+ * Assign every block to a rank and make the blocks of the other ranks remote in Z and W. All the ranks calculate the same assignment.
+ * Call it after Z is initialized: the remote blocks are zero from then on.
+ * @param Z the dual SUP
+ * @param W the SUP that is projected and separated
+ */
+void Distribution::distribute(SUP &Z,SUP &W){
+
+   BlockMatrix *parts_Z[SepStats::n_part] = {&Z.tpm(0),&Z.tpm(1),0,0,0};
+   BlockMatrix *parts_W[SepStats::n_part] = {&W.tpm(0),&W.tpm(1),0,0,0};
+
+#ifdef __G_CON
+
+   parts_Z[2] = &Z.phm();
+   parts_W[2] = &W.phm();
+
+#endif
+
+#ifdef __T1_CON
+
+   parts_Z[3] = &Z.dpm();
+   parts_W[3] = &W.dpm();
+
+#endif
+
+#ifdef __T2_CON
+
+   parts_Z[4] = &Z.pphm();
+   parts_W[4] = &W.pphm();
+
+#endif
+
+   //(part,block) of all the blocks, largest first
+   vector< std::pair<int,int> > blocks;
+
+   for(int k = 0;k < SepStats::n_part;++k)
+      if(parts_W[k] != 0)
+         for(int i = 0;i < parts_W[k]->gnr();++i)
+            blocks.push_back(std::make_pair(k,i));
+
+   std::stable_sort(blocks.begin(),blocks.end(),[&parts_W](const std::pair<int,int> &a,const std::pair<int,int> &b){
+
+         return parts_W[a.first]->gdim(a.second) > parts_W[b.first]->gdim(b.second);
+
+         });
+
+   load.assign(size,0.0);
+   n_blocks.assign(size,0);
+
+   for(unsigned int b = 0;b < blocks.size();++b){
+
+      int k = blocks[b].first;
+      int i = blocks[b].second;
+
+      double n = parts_W[k]->gdim(i);
+
+      int owner = std::min_element(load.begin(),load.end()) - load.begin();
+
+      load[owner] += n*n*n;
+      ++n_blocks[owner];
+
+      if(owner != rank){
+
+         (*parts_Z[k])[i].set_remote();
+         (*parts_W[k])[i].set_remote();
+
+      }
+
+   }
+
+}
+
+/**
+ * Print the number of blocks and the fraction of the work of every rank
+ * @param output The stream to which you are writing (e.g. cout)
+ */
+void Distribution::report(ostream &output){
+
+   double total = 0.0;
+
+   for(unsigned int r = 0;r < load.size();++r)
+      total += load[r];
+
+   for(unsigned int r = 0;r < load.size();++r)
+      output << "rank " << r << ": " << n_blocks[r] << " blocks, " << 100.0*load[r]/total << "% of the work" << endl;
+
+}
+
+/**
+ * @param x the contribution of this rank
+ * @return the sum over all ranks, the same on every rank
+ */
+double Distribution::sum(double x){
+
+#ifdef __MPI
+
+   if(size > 1){
+
+      double ward = 0.0;
+
+      MPI_Reduce(&x,&ward,1,MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+      MPI_Bcast(&ward,1,MPI_DOUBLE,0,MPI_COMM_WORLD);
+
+      return ward;
+
+   }
+
+#endif
+
+   return x;
+
+}
+
+/**
+ * @param x the contribution of this rank
+ * @return the sum over all ranks
+ */
+long Distribution::sum(long x){
+
+   sum(&x,1);
+
+   return x;
+
+}
+
+/**
+ * Sum an array over all ranks
+ * @param x the contribution of this rank, the sum over all ranks on exit
+ * @param n the length of the array
+ */
+void Distribution::sum(long *x,int n){
+
+#ifdef __MPI
+
+   if(size > 1 && n > 0)
+      MPI_Allreduce(MPI_IN_PLACE,x,n,MPI_LONG,MPI_SUM,MPI_COMM_WORLD);
+
+#endif
+
+}
+
+/**
+ * Sum a BlockMatrix, e.g. a collapsed TPM, over all ranks. It is reduced on rank 0 and broadcast, so every rank has the same result.
+ * @param A the contribution of this rank, the sum over all ranks on exit
+ */
+void Distribution::sum(BlockMatrix &A){
+
+#ifdef __MPI
+
+   if(size == 1)
+      return;
+
+   for(int i = 0;i < A.gnr();++i){
+
+      int n = A.gdim(i)*A.gdim(i);
+
+      if(n == 0)
+         continue;
+
+      double *x = A[i].gMatrix()[0];
+
+      if(rank == 0)
+         MPI_Reduce(MPI_IN_PLACE,x,n,MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+      else
+         MPI_Reduce(x,0,n,MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+
+      MPI_Bcast(x,n,MPI_DOUBLE,0,MPI_COMM_WORLD);
+
+   }
+
+#endif
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
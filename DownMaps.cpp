@@ -0,0 +1,225 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+
+using std::endl;
+using std::ostream;
+
+#include "include.h"
+
+/**
+ * constructor: allocates the parts of the active conditions
+ * @param M dimension of sp space
+ * @param N nr of particles
+ */
+DownMaps::DownMaps(int M,int N){
+
+   this->M = M;
+   this->N = N;
+
+   tpm_P = 0;
+   tpm_Q = 0;
+
+   spm_Q = new SPM(M,N);
+
+   ward_Q = 0.0;
+
+#ifdef __G_CON
+
+   phm_G = 0;
+
+   spm_G = new SPM(M,N);
+
+#endif
+
+#ifdef __T1_CON
+
+   tpm_T1 = new TPM(M,N);
+   spm_T1 = new SPM(M,N);
+
+   ward_T1 = 0.0;
+
+#endif
+
+#ifdef __T2_CON
+
+   tpm_T2 = new TPM(M,N);
+   spm_T2 = new SPM(M,N);
+   phm_T2 = new PHM(M,N);
+
+#endif
+
+}
+
+/**
+ * Destructor
+ */
+DownMaps::~DownMaps(){
+
+   delete spm_Q;
+
+#ifdef __G_CON
+
+   delete spm_G;
+
+#endif
+
+#ifdef __T1_CON
+
+   delete tpm_T1;
+   delete spm_T1;
+
+#endif
+
+#ifdef __T2_CON
+
+   delete tpm_T2;
+   delete spm_T2;
+   delete phm_T2;
+
+#endif
+
+}
+
+/**
+ * The P block is only a tp part, it is referenced and has to exist until sum() is called
+ * @param tpm the P block of the SUP
+ */
+void DownMaps::P(const TPM &tpm){
+
+   tpm_P = &tpm;
+
+}
+
+/**
+ * The parts of the Q down map, the block itself is referenced and has to exist until sum() is called
+ * @param tpm the Q block of the SUP
+ */
+void DownMaps::Q(const TPM &tpm){
+
+   tpm_Q = &tpm;
+
+   ward_Q = 1.0/(N*(N - 1.0)) * tpm.trace() * 2.0;
+
+   spm_Q->bar(-1.0/(N - 1.0),tpm);
+
+}
+
+#ifdef __G_CON
+
+/**
+ * The parts of the G down map: it has only an sp and a ph part. The block itself is referenced and has to exist until sum() is called.
+ * @param phm the G block of the SUP
+ */
+void DownMaps::G(const PHM &phm){
+
+   phm_G = &phm;
+
+   spm_G->bar(1.0/(N - 1.0),phm);
+
+}
+
+#endif
+
+#ifdef __T1_CON
+
+/**
+ * The parts of the T1 down map, which is a Q-like map of the bar of the DPM
+ * @param dpm the T1 block of the SUP
+ */
+void DownMaps::T1(const DPM &dpm){
+
+   tpm_T1->bar(dpm);
+
+   ward_T1 = 1.0/(3.0*N*(N - 1.0)) * tpm_T1->trace() * 2.0;
+
+   spm_T1->bar(-0.5/(N - 1.0),*tpm_T1);
+
+}
+
+#endif
+
+#ifdef __T2_CON
+
+/**
+ * The parts of the T2 down map: three independent bars of the PPHM, which are calculated in separate tasks
+ * @param pphm the T2 block of the SUP
+ */
+void DownMaps::T2(const PPHM &pphm){
+
+   const PPHM *p = &pphm;
+
+#pragma omp taskgroup
+   {
+
+#pragma omp task
+      tpm_T2->bar(*p);
+
+#pragma omp task
+      spm_T2->bar(0.5/(N - 1.0),*p);
+
+      phm_T2->bar(*p);
+
+   }
+
+}
+
+#endif
+
+/**
+ * Add all the parts and construct the collapsed TPM, see TPM::collaps
+ * @param tpm output: the collapsed TPM
+ */
+void DownMaps::sum(TPM &tpm) const{
+
+   TPM tp(*tpm_P);
+
+   tp += *tpm_Q;
+
+   double ward = ward_Q;
+
+   SPM spm(*spm_Q);
+
+#ifdef __G_CON
+
+   PHM phm(*phm_G);
+
+   spm += *spm_G;
+
+#endif
+
+#ifdef __T1_CON
+
+   tp += *tpm_T1;
+
+   ward += ward_T1;
+
+   spm += *spm_T1;
+
+#endif
+
+#ifdef __T2_CON
+
+   tp += *tpm_T2;
+
+   spm += *spm_T2;
+
+   phm += *phm_T2;
+
+#endif
+
+#ifdef __G_CON
+
+   tpm.T(ward,tp,spm,phm);
+
+#else
+
+   spm.dscal(-1.0);
+
+   tpm.Q(1.0,ward,spm,tp);
+
+#endif
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,372 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <time.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+using std::endl;
+using std::ostream;
+
+#include "include.h"
+
+namespace {
+
+   /**
+    * @return the wall clock time in seconds
+    */
+   double wtime(){
+
+      timespec ts;
+
+      clock_gettime(CLOCK_MONOTONIC,&ts);
+
+      return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+
+   }
+
+   /**
+    * @return the number of bytes as megabytes
+    */
+   double MB(double bytes){
+
+      return bytes/(1024.0*1024.0);
+
+   }
+
+}
+
+/**
+ * constructor: collects the dimensions of the blocks of a SUP with the active conditions
+ * @param M dimension of sp space
+ * @param N nr of particles
+ * @param single the projections are done in single precision
+ * @param ooc_dim blocks with dimension ooc_dim and larger are stored out-of-core, 0 means none, see Matrix::set_mmap
+ */
+Estimate::Estimate(int M,int N,bool single,int ooc_dim){
+
+   this->M = M;
+   this->N = N;
+   this->single = single;
+   this->ooc_dim = ooc_dim;
+
+   nr = 0;
+
+   for(int i = 0;i < 2;++i)
+      add("P",i,TPM::block_dim(M,i));
+
+   for(int i = 0;i < 2;++i)
+      add("Q",i,TPM::block_dim(M,i));
+
+#ifdef __G_CON
+
+   for(int i = 0;i < 2;++i)
+      add("G",i,PHM::block_dim(M,i));
+
+#endif
+
+#ifdef __T1_CON
+
+   for(int i = 0;i < 2;++i)
+      add("T1",i,DPM::block_dim(M,i));
+
+#endif
+
+#ifdef __T2_CON
+
+   for(int i = 0;i < 2;++i)
+      add("T2",i,PPHM::block_dim(M,i));
+
+#endif
+
+   eig_rate = 0.0;
+   map_rate = 0.0;
+
+}
+
+/**
+ * add a block to the list
+ * @param name name of the part
+ * @param i index of the block in the part
+ * @param dim dimension of the block
+ */
+void Estimate::add(const char *name,int i,int dim){
+
+   this->name[nr] = name;
+   this->index[nr] = i;
+   this->dim[nr] = dim;
+
+   ++nr;
+
+}
+
+/**
+ * @return the number of bytes of one SUP
+ */
+long Estimate::sup_bytes() const{
+
+   long ward = 0;
+
+   for(int i = 0;i < nr;++i)
+      ward += 8L*dim[i]*dim[i];
+
+   return ward;
+
+}
+
+/**
+ * @return the number of bytes of scratch memory needed by sep_pm: every block that is being separated needs a scratch block and the dsyev
+ * workspace, or in single precision a float copy and the ssyevd workspace (see Matrix::sep_pm_single). The blocks are separated by concurrent
+ * tasks, so at most one block per thread holds its scratch at the same time: the scratch of the largest blocks, as many as there are threads,
+ * is counted.
+ */
+long Estimate::scratch_bytes() const{
+
+   long ward = 0;
+
+   std::vector<int> sorted(dim,dim + nr);
+
+   std::sort(sorted.begin(),sorted.end(),std::greater<int>());
+
+   int concurrent = std::min(nr,ThreadBudget::gthreads());
+
+   for(int i = 0;i < concurrent;++i){
+
+      long n = sorted[i];
+
+      if(single)//float copy, eigenvalues and ssyevd workspace, which holds the ssyrk output
+         ward += 4L*(n*n + n + 1 + 6*n + 2*n*n) + 4L*(3 + 5*n);
+      else//eigenvectors moved out of W and dsyev workspace
+         ward += 8L*(n*n + 4*n);
+
+   }
+
+   return ward;
+
+}
+
+/**
+ * @return the number of bytes of the TPM and PHM temporaries of the solver, the projection and the collaps
+ */
+long Estimate::temp_bytes() const{
+
+   long tpm = 0;
+
+   for(int i = 0;i < 2;++i)
+      tpm += 8L*TPM::block_dim(M,i)*TPM::block_dim(M,i);
+
+   long ward = 12*tpm;
+
+#ifdef __G_CON
+
+   long phm = 0;
+
+   for(int i = 0;i < 2;++i)
+      phm += 8L*PHM::block_dim(M,i)*PHM::block_dim(M,i);
+
+   ward += 2*phm;
+
+#endif
+
+   return ward;
+
+}
+
+/**
+ * @return the estimated peak resident memory in bytes: the solver keeps three SUP's (X, Z and W) alive, X at full rank,
+ * plus the scratch of sep_pm and the temporaries. Out-of-core blocks are not counted.
+ */
+long Estimate::peak_bytes() const{
+
+   long ward = 0;
+
+   for(int i = 0;i < nr;++i)
+      if(ooc_dim == 0 || dim[i] < ooc_dim)
+         ward += 3*8L*dim[i]*dim[i];
+
+   return ward + scratch_bytes() + temp_bytes();
+
+}
+
+/**
+ * @return the number of bytes that are stored in memory mapped files
+ */
+long Estimate::disk_bytes() const{
+
+   long ward = 0;
+
+   for(int i = 0;i < nr;++i)
+      if(ooc_dim > 0 && dim[i] >= ooc_dim)
+         ward += 3*8L*dim[i]*dim[i];
+
+   return ward;
+
+}
+
+/**
+ * @return the number of flops of the eigendecompositions in one iteration: at most two projections per iteration, each about 10 n^3
+ * for a block of dimension n (dsyev with eigenvectors and the construction of the plus and minus part). Definite blocks are cheaper.
+ */
+double Estimate::flops() const{
+
+   double ward = 0.0;
+
+   for(int i = 0;i < nr;++i)
+      ward += 10.0 * std::pow((double)dim[i],3);
+
+   return 2.0 * ward;
+
+}
+
+/**
+ * Calibrate the time estimate with a short benchmark: sep_pm on a random matrix with the dimension of the largest block (at most 200),
+ * and a fill and collaps of a SUP for at most M = 8. The best of three runs is used.
+ */
+void Estimate::calibrate(){
+
+   int n = 0;
+
+   for(int i = 0;i < nr;++i)
+      if(dim[i] > n)
+         n = dim[i];
+
+   if(n > 200)
+      n = 200;
+
+   Matrix A(n);
+   A.fill_Random();
+
+   Matrix W(n);
+   Matrix p(n);
+   Matrix m(n);
+
+   double best = 0.0;
+
+   //the kernels create tasks, which are executed by the threads of this region
+   #pragma omp parallel
+   #pragma omp single
+   for(int r = 0;r < 3;++r){
+
+      W = A;
+
+      double start = wtime();
+
+      W.sep_pm(p,m,single);
+
+      double time = wtime() - start;
+
+      if(r == 0 || time < best)
+         best = time;
+
+   }
+
+   eig_rate = 10.0 * std::pow((double)n,3) / best;
+
+   //the maps
+   int M_c = (M < 8) ? M : 8;
+   int N_c = (N < M_c) ? N : M_c/2;
+
+   SUP S(M_c,N_c);
+   TPM tpm(M_c,N_c);
+
+   tpm.fill_Random();
+
+   long elements = 0;
+
+   for(int i = 0;i < 2;++i)
+      elements += 2L*TPM::block_dim(M_c,i)*TPM::block_dim(M_c,i);
+
+#ifdef __G_CON
+
+   for(int i = 0;i < 2;++i)
+      elements += (long)PHM::block_dim(M_c,i)*PHM::block_dim(M_c,i);
+
+#endif
+
+#ifdef __T1_CON
+
+   for(int i = 0;i < 2;++i)
+      elements += (long)DPM::block_dim(M_c,i)*DPM::block_dim(M_c,i);
+
+#endif
+
+#ifdef __T2_CON
+
+   for(int i = 0;i < 2;++i)
+      elements += (long)PPHM::block_dim(M_c,i)*PPHM::block_dim(M_c,i);
+
+#endif
+
+   #pragma omp parallel
+   #pragma omp single
+   for(int r = 0;r < 3;++r){
+
+      double start = wtime();
+
+      S.fill(tpm);
+      tpm.collaps(1,S);
+
+      double time = wtime() - start;
+
+      if(r == 0 || time < best)
+         best = time;
+
+   }
+
+   map_rate = elements / best;
+
+}
+
+/**
+ * @return the estimated time per iteration in seconds: two projections, each with a fill, a collaps and the eigendecompositions.
+ * 0 if the estimate has not been calibrated.
+ */
+double Estimate::time_per_iteration() const{
+
+   if(eig_rate == 0.0)
+      return 0.0;
+
+   return flops() / eig_rate + 2.0 * (sup_bytes() / 8.0) / map_rate;
+
+}
+
+ostream &operator<<(ostream &output,const Estimate &est_p){
+
+   output << "blocks of a SUP:" << endl;
+
+   for(int i = 0;i < est_p.nr;++i){
+
+      output << est_p.name[i] << "\tblock " << est_p.index[i] << "\tdim " << est_p.dim[i] << "\t" << MB(8.0*est_p.dim[i]*est_p.dim[i]) << " MB";
+
+      if(est_p.ooc_dim > 0 && est_p.dim[i] >= est_p.ooc_dim)
+         output << "\t(out-of-core)";
+
+      output << endl;
+
+   }
+
+   output << endl;
+   output << "memory per SUP: " << MB(est_p.sup_bytes()) << " MB" << endl;
+   output << "scratch of the projection: " << MB(est_p.scratch_bytes()) << " MB" << endl;
+   output << "temporaries: " << MB(est_p.temp_bytes()) << " MB" << endl;
+   output << "peak matrix memory (3 SUP's + scratch + temporaries, without program and index lists): " << MB(est_p.peak_bytes()) << " MB" << endl;
+
+   if(est_p.ooc_dim > 0)
+      output << "out-of-core: " << MB(est_p.disk_bytes()) << " MB" << endl;
+
+   output << "eigendecomposition flops per iteration: " << est_p.flops() << endl;
+
+   if(est_p.eig_rate > 0.0){
+
+      output << "calibrated eigendecomposition rate: " << est_p.eig_rate * 1.0e-9 << " GFLOP/s" << endl;
+      output << "calibrated map rate: " << est_p.map_rate * 1.0e-6 << " M elements/s" << endl;
+      output << "time per iteration: " << est_p.time_per_iteration() << " s" << endl;
+
+   }
+
+   return output;
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,196 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <vector>
+
+using std::endl;
+using std::ostream;
+using std::vector;
+
+#include "include.h"
+
+/**
+ * constructor: all the blocks are initialized to zero
+ * @param shape BlockMatrix from which the dimensions and the degeneracies of the blocks are taken
+ * @param fraction a block with dimension n is kept in factored form as long as its rank is not larger than fraction * n
+ */
+LRBlockMatrix::LRBlockMatrix(const BlockMatrix &shape,double fraction){
+
+   this->nr = shape.gnr();
+
+   blocks = new LRMatrix * [nr];
+
+   degen = new int [nr];
+
+   for(int i = 0;i < nr;++i){
+
+      degen[i] = shape.gdeg(i);
+
+      blocks[i] = new LRMatrix(shape.gdim(i),(int)(fraction * shape.gdim(i)));
+
+   }
+
+}
+
+/**
+ * copy constructor
+ * @param lr_copy The LRBlockMatrix to be copied into the object you are constructing
+ */
+LRBlockMatrix::LRBlockMatrix(const LRBlockMatrix &lr_copy){
+
+   this->nr = lr_copy.nr;
+
+   blocks = new LRMatrix * [nr];
+
+   degen = new int [nr];
+
+   for(int i = 0;i < nr;++i){
+
+      degen[i] = lr_copy.degen[i];
+
+      blocks[i] = new LRMatrix(*lr_copy.blocks[i]);
+
+   }
+
+}
+
+/**
+ * Destructor
+ */
+LRBlockMatrix::~LRBlockMatrix(){
+
+   for(int i = 0;i < nr;++i)
+      delete blocks[i];
+
+   delete [] blocks;
+
+   delete [] degen;
+
+}
+
+/**
+ * overload the equality operator, the block structure of both objects has to be the same
+ * @param lr_copy The LRBlockMatrix to be copied into this
+ */
+LRBlockMatrix &LRBlockMatrix::operator=(const LRBlockMatrix &lr_copy){
+
+   for(int i = 0;i < nr;++i)
+      *blocks[i] = *lr_copy.blocks[i];
+
+   return *this;
+
+}
+
+/**
+ * @param i which block
+ * @return a reference to block i
+ */
+LRMatrix &LRBlockMatrix::operator[](int i){
+
+   return *blocks[i];
+
+}
+
+/**
+ * @param i which block
+ * @return a const reference to block i
+ */
+const LRMatrix &LRBlockMatrix::operator[](int i) const{
+
+   return *blocks[i];
+
+}
+
+/**
+ * @return the number of blocks
+ */
+int LRBlockMatrix::gnr() const{
+
+   return nr;
+
+}
+
+/**
+ * @param i which block
+ * @return the degeneracy of block i
+ */
+int LRBlockMatrix::gdeg(int i) const{
+
+   return degen[i];
+
+}
+
+/**
+ * Add alpha times (*this) to the BlockMatrix W, see LRMatrix::add_to
+ * @param alpha the factor
+ * @param W output: the blockmatrix to which alpha (*this) is added
+ */
+void LRBlockMatrix::add_to(double alpha,BlockMatrix &W) const{
+
+   for(int i = 0;i < nr;++i)
+      blocks[i]->add_to(alpha,W[i]);
+
+}
+
+/**
+ * @param A input BlockMatrix
+ * @return inproduct Tr (this A) with the degeneracies of the blocks taken into account
+ */
+double LRBlockMatrix::ddot(const BlockMatrix &A) const{
+
+   double ward = 0.0;
+
+   for(int i = 0;i < nr;++i)
+      ward += degen[i]*blocks[i]->ddot(A[i]);
+
+   return ward;
+
+}
+
+/**
+ * Replace (*this) by V and return the squared distance between the old and the new (*this), see LRMatrix::update
+ * @param V the new blockmatrix in dense form, undefined on exit
+ * @param V_f the factors of the blocks of V, undefined on exit
+ * @return the squared norm of (*this) - V before the update, with the degeneracies of the blocks taken into account
+ */
+double LRBlockMatrix::update(BlockMatrix &V,LRBlockMatrix &V_f){
+
+   vector<double> part(nr,0.0);
+   vector<int> node(nr);
+
+   for(int i = 0;i < nr;++i)
+      node[i] = V[i].gnode();
+
+   //every block is a task on the node of its block of V (see Numa::run), the distances are added in a fixed order afterwards
+   Numa::run(nr,node.data(),[&](int i){
+
+      //the primal blocks of other MPI ranks stay zero, see Distribution
+      if(!V[i].gremote())
+         part[i] = blocks[i]->update(V[i],V_f[i]);
+
+   });
+
+   double ward = 0.0;
+
+   for(int i = 0;i < nr;++i)
+      ward += degen[i]*part[i];
+
+   return ward;
+
+}
+
+/**
+ * @return the number of doubles that are stored
+ */
+long LRBlockMatrix::memory() const{
+
+   long ward = 0;
+
+   for(int i = 0;i < nr;++i)
+      ward += blocks[i]->memory();
+
+   return ward;
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,400 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+
+using std::endl;
+using std::ostream;
+
+#include "include.h"
+
+/**
+ * constructor: the matrix is initialized to zero, which is stored as a factor of rank 0
+ * @param n dimension of the matrix
+ * @param r_max the maximal rank for which the factored form is kept
+ */
+LRMatrix::LRMatrix(int n,int r_max){
+
+   this->n = n;
+   this->r_max = r_max;
+
+   r = 0;
+
+   F = 0;
+   dense = 0;
+
+}
+
+/**
+ * copy constructor
+ * @param lr_copy The LRMatrix to be copied into the object you are constructing
+ */
+LRMatrix::LRMatrix(const LRMatrix &lr_copy){
+
+   this->n = lr_copy.n;
+   this->r_max = lr_copy.r_max;
+
+   r = 0;
+
+   F = 0;
+   dense = 0;
+
+   *this = lr_copy;
+
+}
+
+/**
+ * Destructor
+ */
+LRMatrix::~LRMatrix(){
+
+   delete [] F;
+
+   delete dense;
+
+}
+
+/**
+ * overload the equality operator: the storage of (*this) is adapted to that of lr_copy
+ * @param lr_copy The LRMatrix to be copied into this
+ */
+LRMatrix &LRMatrix::operator=(const LRMatrix &lr_copy){
+
+   if(lr_copy.r >= 0){
+
+      double *F_c = this->set_rank(lr_copy.r);
+
+      for(int i = 0;i < n*r;++i)
+         F_c[i] = lr_copy.F[i];
+
+   }
+   else{
+
+      this->set_rank(-1);
+
+      if(lr_copy.dense != 0){
+
+         if(dense == 0)
+            dense = new Matrix(lr_copy.dense->gn());
+
+         *dense = *lr_copy.dense;
+
+      }
+      else{
+
+         delete dense;
+         dense = 0;
+
+      }
+
+   }
+
+   return *this;
+
+}
+
+/**
+ * @return the dimension of the matrix
+ */
+int LRMatrix::gn() const{
+
+   return n;
+
+}
+
+/**
+ * @return the rank of the factor, -1 if the matrix is not stored in factored form
+ */
+int LRMatrix::gr() const{
+
+   return r;
+
+}
+
+/**
+ * @return the maximal rank for which the factored form is kept
+ */
+int LRMatrix::gr_max() const{
+
+   return r_max;
+
+}
+
+/**
+ * @return true if the matrix is stored in factored form
+ */
+bool LRMatrix::factored() const{
+
+   return (r >= 0);
+
+}
+
+/**
+ * Switch to factored form with a factor of rank r, the dense matrix is deallocated. With r = -1 the factor is
+ * deallocated and the matrix is no longer in factored form: the dense matrix is left untouched.
+ * @param r the new rank
+ * @return pointer to the n x r factor (column major) that has to be filled by the caller, 0 if r = -1
+ */
+double *LRMatrix::set_rank(int r){
+
+   if(r < 0){
+
+      delete [] F;
+
+      F = 0;
+
+      this->r = -1;
+
+      return 0;
+
+   }
+
+   if(r != this->r || F == 0){
+
+      delete [] F;
+
+      F = new double [n*r + 1];
+
+   }
+
+   this->r = r;
+
+   delete dense;
+   dense = 0;
+
+   return F;
+
+}
+
+/**
+ * Construct the dense form of (*this)
+ * @param A output: (*this) as a dense matrix
+ */
+void LRMatrix::expand(Matrix &A) const{
+
+   if(r == 0)
+      A = 0.0;
+   else if(r > 0){
+
+      char uplo = 'U';
+      char trans = 'N';
+
+      double alpha = 1.0;
+      double beta = 0.0;
+
+      int rank = r;
+      int dim = n;
+
+      dsyrk_(&uplo,&trans,&dim,&rank,&alpha,F,&dim,&beta,A.matrix[0],&dim);
+
+      A.symmetrize();
+
+   }
+   else
+      A = *dense;
+
+}
+
+/**
+ * Add alpha times (*this) to the matrix W. In factored form this is a rank r update of W, which only has to read the n x r factor
+ * instead of the n x n matrix.
+ * @param alpha the factor
+ * @param W output: the matrix to which alpha (*this) is added
+ */
+void LRMatrix::add_to(double alpha,Matrix &W) const{
+
+   if(r > 0){
+
+      char uplo = 'U';
+      char trans = 'N';
+
+      double beta = 1.0;
+
+      int rank = r;
+      int dim = n;
+
+      dsyrk_(&uplo,&trans,&dim,&rank,&alpha,F,&dim,&beta,W.matrix[0],&dim);
+
+      W.symmetrize();
+
+   }
+   else if(r < 0)
+      W.daxpy(alpha,*dense);
+
+}
+
+/**
+ * @param A input matrix
+ * @return inproduct Tr (this A), in factored form Tr (F^T A F)
+ */
+double LRMatrix::ddot(const Matrix &A) const{
+
+   if(r == 0)
+      return 0.0;
+
+   if(r < 0)
+      return dense->ddot(A);
+
+   double *AF = new double [n*r];
+
+   char side = 'L';
+   char uplo = 'U';
+
+   double alpha = 1.0;
+   double beta = 0.0;
+
+   int rank = r;
+   int dim = n;
+
+   dsymm_(&side,&uplo,&dim,&rank,&alpha,A.matrix[0],&dim,F,&dim,&beta,AF,&dim);
+
+   int size = n*r;
+   int inc = 1;
+
+   double ward = ddot_(&size,F,&inc,AF,&inc);
+
+   delete [] AF;
+
+   return ward;
+
+}
+
+/**
+ * Replace (*this) by V and return the squared distance between the old and the new (*this). In factored form the distance is summed
+ * over tiles of F F^T, no dense matrix is formed. When the factor of V in V_f is available and
+ * its rank is not larger than r_max, (*this) takes over the factor and V_f gets the old storage of (*this). Otherwise the dense memory of
+ * (*this) and V are swapped. In both cases the content of V and V_f is undefined on exit.
+ * @param V the new matrix in dense form
+ * @param V_f the factor of V, if it is available
+ * @return the squared Frobenius norm of (*this) - V before the update
+ */
+double LRMatrix::update(Matrix &V,LRMatrix &V_f){
+
+   //the distance is calculated elementwise to avoid cancellations
+   double ward = 0.0;
+
+   if(r >= 0){
+
+      //in factored form F F^T is expanded one tile at a time, the tiles below the diagonal are the transposes of those above it
+      const int tile = 128;
+
+      double *T = new double [tile*tile];
+
+      for(int j0 = 0;j0 < n;j0 += tile)
+         for(int i0 = 0;i0 <= j0;i0 += tile){
+
+            int bi = std::min(tile,n - i0);
+            int bj = std::min(tile,n - j0);
+
+            if(r > 0){
+
+               char transa = 'N';
+               char transb = 'T';
+
+               double alpha = 1.0;
+               double beta = 0.0;
+
+               int lda = n;
+               int rank = r;
+
+               dgemm_(&transa,&transb,&bi,&bj,&rank,&alpha,F + i0,&lda,F + j0,&lda,&beta,T,&bi);
+
+            }
+            else
+               for(int i = 0;i < bi*bj;++i)
+                  T[i] = 0.0;
+
+            double part = 0.0;
+
+            for(int j = 0;j < bj;++j)
+               for(int i = 0;i < bi;++i){
+
+                  double diff = T[j*bi + i] - V.matrix[j0 + j][i0 + i];
+
+                  part += diff*diff;
+
+               }
+
+            ward += (i0 == j0) ? part : 2.0*part;
+
+         }
+
+      delete [] T;
+
+   }
+   else{
+
+      for(int i = 0;i < n*n;++i){
+
+         double diff = dense->matrix[0][i] - V.matrix[0][i];
+
+         ward += diff*diff;
+
+      }
+
+   }
+
+   if(V_f.r >= 0 && V_f.r <= r_max){
+
+      double *F_hulp = F;
+      F = V_f.F;
+      V_f.F = F_hulp;
+
+      int r_hulp = r;
+      r = V_f.r;
+      V_f.r = r_hulp;
+
+      delete dense;
+      dense = 0;
+
+   }
+   else{
+
+      //the memory of (*this) and V is swapped every update: keep both on the NUMA node of V
+      if(dense == 0){
+
+         dense = new Matrix(n);
+
+         if(V.gnode() != -1)
+            dense->bind(V.gnode());
+
+      }
+
+      dense->swap(V);
+
+      this->set_rank(-1);
+
+   }
+
+   return ward;
+
+}
+
+/**
+ * @return the number of doubles that are stored
+ */
+long LRMatrix::memory() const{
+
+   if(r >= 0)
+      return (long)n*r;
+
+   if(dense != 0)
+      return (long)n*n;
+
+   return 0;
+
+}
+
+/**
+ * @return the NUMA node of the dense matrix, see Matrix::gnode, -1 in factored form
+ */
+int LRMatrix::gnode() const{
+
+   if(r >= 0 || dense == 0)
+      return -1;
+
+   return dense->gnode();
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
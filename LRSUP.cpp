@@ -0,0 +1,368 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+
+using std::endl;
+using std::ostream;
+
+#include "include.h"
+
+/**
+ * constructor: all the blocks are initialized to zero
+ * @param shape SUP from which the block structure is taken
+ * @param fraction blocks are kept in factored form as long as their rank is not larger than fraction times their dimension
+ */
+LRSUP::LRSUP(const SUP &shape,double fraction){
+
+   lr_tp = new LRBlockMatrix * [2];
+
+   for(int i = 0;i < 2;++i)
+      lr_tp[i] = new LRBlockMatrix(shape.tpm(i),fraction);
+
+#ifdef __G_CON
+
+   lr_ph = new LRBlockMatrix(shape.phm(),fraction);
+
+#endif
+
+#ifdef __T1_CON
+
+   lr_dp = new LRBlockMatrix(shape.dpm(),fraction);
+
+#endif
+
+#ifdef __T2_CON
+
+   lr_pph = new LRBlockMatrix(shape.pphm(),fraction);
+
+#endif
+
+}
+
+/**
+ * copy constructor
+ * @param lr_copy The LRSUP to be copied into the object you are constructing
+ */
+LRSUP::LRSUP(const LRSUP &lr_copy){
+
+   lr_tp = new LRBlockMatrix * [2];
+
+   for(int i = 0;i < 2;++i)
+      lr_tp[i] = new LRBlockMatrix(*lr_copy.lr_tp[i]);
+
+#ifdef __G_CON
+
+   lr_ph = new LRBlockMatrix(*lr_copy.lr_ph);
+
+#endif
+
+#ifdef __T1_CON
+
+   lr_dp = new LRBlockMatrix(*lr_copy.lr_dp);
+
+#endif
+
+#ifdef __T2_CON
+
+   lr_pph = new LRBlockMatrix(*lr_copy.lr_pph);
+
+#endif
+
+}
+
+/**
+ * Destructor
+ */
+LRSUP::~LRSUP(){
+
+   for(int i = 0;i < 2;++i)
+      delete lr_tp[i];
+
+   delete [] lr_tp;
+
+#ifdef __G_CON
+
+   delete lr_ph;
+
+#endif
+
+#ifdef __T1_CON
+
+   delete lr_dp;
+
+#endif
+
+#ifdef __T2_CON
+
+   delete lr_pph;
+
+#endif
+
+}
+
+/**
+ * overload the equality operator
+ * @param lr_copy The LRSUP to be copied into this
+ */
+LRSUP &LRSUP::operator=(const LRSUP &lr_copy){
+
+   for(int i = 0;i < 2;++i)
+      *lr_tp[i] = *lr_copy.lr_tp[i];
+
+#ifdef __G_CON
+
+   *lr_ph = *lr_copy.lr_ph;
+
+#endif
+
+#ifdef __T1_CON
+
+   *lr_dp = *lr_copy.lr_dp;
+
+#endif
+
+#ifdef __T2_CON
+
+   *lr_pph = *lr_copy.lr_pph;
+
+#endif
+
+   return *this;
+
+}
+
+/**
+ * @param i 0 for the P block, 1 for the Q block
+ * @return a reference to the i'th tp block
+ */
+LRBlockMatrix &LRSUP::tp(int i){
+
+   return *lr_tp[i];
+
+}
+
+/**
+ * @param i 0 for the P block, 1 for the Q block
+ * @return a const reference to the i'th tp block
+ */
+const LRBlockMatrix &LRSUP::tp(int i) const{
+
+   return *lr_tp[i];
+
+}
+
+#ifdef __G_CON
+
+/**
+ * @return a reference to the G block
+ */
+LRBlockMatrix &LRSUP::ph(){
+
+   return *lr_ph;
+
+}
+
+/**
+ * @return a const reference to the G block
+ */
+const LRBlockMatrix &LRSUP::ph() const{
+
+   return *lr_ph;
+
+}
+
+#endif
+
+#ifdef __T1_CON
+
+/**
+ * @return a reference to the T1 block
+ */
+LRBlockMatrix &LRSUP::dp(){
+
+   return *lr_dp;
+
+}
+
+/**
+ * @return a const reference to the T1 block
+ */
+const LRBlockMatrix &LRSUP::dp() const{
+
+   return *lr_dp;
+
+}
+
+#endif
+
+#ifdef __T2_CON
+
+/**
+ * @return a reference to the T2 block
+ */
+LRBlockMatrix &LRSUP::pph(){
+
+   return *lr_pph;
+
+}
+
+/**
+ * @return a const reference to the T2 block
+ */
+const LRBlockMatrix &LRSUP::pph() const{
+
+   return *lr_pph;
+
+}
+
+#endif
+
+/**
+ * Add alpha times (*this) to the SUP W, see LRMatrix::add_to
+ * @param alpha the factor
+ * @param W output: the SUP to which alpha (*this) is added
+ */
+void LRSUP::add_to(double alpha,SUP &W) const{
+
+   for(int i = 0;i < 2;++i)
+      lr_tp[i]->add_to(alpha,W.tpm(i));
+
+#ifdef __G_CON
+
+   lr_ph->add_to(alpha,W.phm());
+
+#endif
+
+#ifdef __T1_CON
+
+   lr_dp->add_to(alpha,W.dpm());
+
+#endif
+
+#ifdef __T2_CON
+
+   lr_pph->add_to(alpha,W.pphm());
+
+#endif
+
+}
+
+/**
+ * @param A input SUP
+ * @return inproduct Tr (this A)
+ */
+double LRSUP::ddot(const SUP &A) const{
+
+   double ward = 0.0;
+
+   for(int i = 0;i < 2;++i)
+      ward += lr_tp[i]->ddot(A.tpm(i));
+
+#ifdef __G_CON
+
+   ward += lr_ph->ddot(A.phm());
+
+#endif
+
+#ifdef __T1_CON
+
+   ward += lr_dp->ddot(A.dpm());
+
+#endif
+
+#ifdef __T2_CON
+
+   ward += lr_pph->ddot(A.pphm());
+
+#endif
+
+   return ward;
+
+}
+
+/**
+ * Replace (*this) by V and return the squared distance between the old and the new (*this), see LRMatrix::update.
+ * Used for the primal update in the boundary point method. Every condition is a task, the largest first, with a task for every block
+ * (see LRBlockMatrix::update). The distances are added in a fixed order, so the result doesn't depend on the number of threads.
+ * @param V the new SUP in dense form, undefined on exit
+ * @param V_f the factors of the blocks of V as calculated by SUP::proj_U_sep, undefined on exit
+ * @return the squared norm of (*this) - V before the update
+ */
+double LRSUP::update(SUP &V,LRSUP &V_f){
+
+   //in the order of the parts of SepStats
+   double part[SepStats::n_part] = {0.0,0.0,0.0,0.0,0.0};
+
+   #pragma omp taskgroup
+   {
+
+#ifdef __T2_CON
+
+      #pragma omp task shared(V,V_f,part)
+      part[4] = lr_pph->update(V.pphm(),V_f.pph());
+
+#endif
+
+#ifdef __T1_CON
+
+      #pragma omp task shared(V,V_f,part)
+      part[3] = lr_dp->update(V.dpm(),V_f.dp());
+
+#endif
+
+#ifdef __G_CON
+
+      #pragma omp task shared(V,V_f,part)
+      part[2] = lr_ph->update(V.phm(),V_f.ph());
+
+#endif
+
+      #pragma omp task shared(V,V_f,part)
+      part[1] = lr_tp[1]->update(V.tpm(1),V_f.tp(1));
+
+      part[0] = lr_tp[0]->update(V.tpm(0),V_f.tp(0));
+
+   }
+
+   double ward = 0.0;
+
+   for(int k = 0;k < SepStats::n_part;++k)
+      ward += part[k];
+
+   return ward;
+
+}
+
+/**
+ * @return the number of doubles that are stored
+ */
+long LRSUP::memory() const{
+
+   long ward = 0;
+
+   for(int i = 0;i < 2;++i)
+      ward += lr_tp[i]->memory();
+
+#ifdef __G_CON
+
+   ward += lr_ph->memory();
+
+#endif
+
+#ifdef __T1_CON
+
+   ward += lr_dp->memory();
+
+#endif
+
+#ifdef __T2_CON
+
+   ward += lr_pph->memory();
+
+#endif
+
+   return ward;
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,1199 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+using std::endl;
+using std::ostream;
+
+#include "include.h"
+
+int MapStreams::isa = -1;
+
+vector< std::unique_ptr<MapStreams> > MapStreams::streams;
+
+std::string MapStreams::cache_dir;
+
+namespace{
+
+   //the names of the instruction sets, in the order of MapStreams::isa
+   const char *isa_names[] = {"scalar","avx2","avx512"};
+
+   //version of the layout of the cache files, has to change when the streams change
+   const int cache_version = 1;
+
+   //the cache file starts with "spinbpms", the version, M, sizeof(int), sizeof(double) and n, size, n_k, n_c of the 7 streams
+   const int header_ints = 4 + 7*4;
+
+   //offset of the next array in the cache file: every array starts on a cache line
+   size_t next(size_t offset,size_t bytes){
+
+      return (offset + bytes + 63)/64*64;
+
+   }
+
+}
+
+/**
+ * Allocate the streams of a map on a block of dimension n: the elements (i,j) with i <= j, column by column
+ * @param n dimension of the output block
+ * @param n_k number of index streams
+ * @param n_c number of coefficient streams
+ * @param per_element number of entries per element (the terms of a sum that is vectorized over the elements)
+ */
+void MapStreams::Stream::init(int n,int n_k,int n_c,int per_element){
+
+   this->n = n;
+   this->n_k = n_k;
+   this->n_c = n_c;
+
+   mapped = false;
+
+   col = new int [n];
+   n_pad = new int [n];
+
+   int size = 0;
+
+   for(int j = 0;j < n;++j){
+
+      col[j] = size;
+      n_pad[j] = 8*((j + 8)/8);
+
+      size += n_pad[j]*per_element;
+
+   }
+
+   this->size = size;
+
+   //the padding has index 0 and coefficient 0
+   for(int t = 0;t < 8;++t){
+
+      k[t] = (t < n_k) ? new int [size]() : 0;
+      c[t] = (t < n_c) ? new double [size]() : 0;
+
+   }
+
+}
+
+/**
+ * Destructor of the streams
+ */
+MapStreams::Stream::~Stream(){
+
+   if(mapped)
+      return;
+
+   delete [] col;
+   delete [] n_pad;
+
+   for(int t = 0;t < 8;++t){
+
+      delete [] k[t];
+      delete [] c[t];
+
+   }
+
+}
+
+/**
+ * constructor: fill the streams of all the maps for sp dimension M
+ * @param M dimension of the sp space
+ */
+MapStreams::MapStreams(int M){
+
+   this->M = M;
+
+   map = 0;
+   map_bytes = 0;
+
+   if(!cache_dir.empty() && load())
+      return;
+
+   //the lists of TPM and PHM only depend on M, these objects keep them alive while the streams are filled
+   TPM tpm(M,2);
+   PHM phm(M,2);
+
+   int m = M/2;
+
+   int n_tp[2] = {tpm.gdim(0),tpm.gdim(1)};
+   int n_ph = phm.gdim(0);
+
+   //TPM::Q: four sp terms and the np part
+   for(int S = 0;S < 2;++S){
+
+      int sign = 1 - 2*S;
+
+      Stream &s = q[S];
+
+      s.init(n_tp[S],4,5,1);
+
+      for(int j = 0;j < s.n;++j)
+         for(int i = 0;i <= j;++i){
+
+            int a = TPM::t2s[S][i][0];
+            int b = TPM::t2s[S][i][1];
+
+            int c = TPM::t2s[S][j][0];
+            int d = TPM::t2s[S][j][1];
+
+            double norm = 1.0;
+
+            if(S == 0){
+
+               if(a == b)
+                  norm /= std::sqrt(2.0);
+
+               if(c == d)
+                  norm /= std::sqrt(2.0);
+
+            }
+
+            int e = s.col[j] + i;
+
+            if(a == c){
+
+               s.k[0][e] = b + d*m;
+               s.c[0][e] = norm;
+
+            }
+
+            if(b == c){
+
+               s.k[1][e] = a + d*m;
+               s.c[1][e] = sign*norm;
+
+            }
+
+            if(a == d){
+
+               s.k[2][e] = b + c*m;
+               s.c[2][e] = sign*norm;
+
+            }
+
+            if(b == d){
+
+               s.k[3][e] = a + c*m;
+               s.c[3][e] = norm;
+
+            }
+
+            if(i == j)
+               s.c[4][e] = 1.0;
+
+         }
+
+   }
+
+   //PHM::G: the S = 0 and S = 1 tp element, the two norms and the sp term
+   for(int S = 0;S < 2;++S){
+
+      Stream &s = g[S];
+
+      s.init(n_ph,3,5,1);
+
+      for(int j = 0;j < s.n;++j)
+         for(int i = 0;i <= j;++i){
+
+            int a = PHM::ph2s[i][0];
+            int b = PHM::ph2s[i][1];
+
+            int c = PHM::ph2s[j][0];
+            int d = PHM::ph2s[j][1];
+
+            int e = s.col[j] + i;
+
+            s.k[0][e] = TPM::s2t[0][a][d] + n_tp[0]*TPM::s2t[0][c][b];
+            s.c[0][e] = -PHM::_6j[S][0];
+
+            //the antisymmetric element is zero when a == d or c == b, else it has a phase
+            if(a != d && c != b){
+
+               int phase = 1;
+
+               if(a > d)
+                  phase *= -1;
+               if(c > b)
+                  phase *= -1;
+
+               s.k[1][e] = TPM::s2t[1][a][d] + n_tp[1]*TPM::s2t[1][c][b];
+               s.c[1][e] = 3.0*PHM::_6j[S][1]*phase;
+
+            }
+
+            s.c[2][e] = (a == d) ? std::sqrt(2.0) : 1.0;
+            s.c[3][e] = (c == b) ? std::sqrt(2.0) : 1.0;
+
+            if(b == d){
+
+               s.k[2][e] = a + c*m;
+               s.c[4][e] = 1.0;
+
+            }
+
+         }
+
+   }
+
+   //TPM::G: four ph elements (the same places in both blocks of the PHM), four sp terms and the two norms
+   for(int S = 0;S < 2;++S){
+
+      int sign = 1 - 2*S;
+
+      Stream &s = g_down[S];
+
+      s.init(n_tp[S],8,6,1);
+
+      for(int j = 0;j < s.n;++j)
+         for(int i = 0;i <= j;++i){
+
+            int a = TPM::t2s[S][i][0];
+            int b = TPM::t2s[S][i][1];
+
+            int c = TPM::t2s[S][j][0];
+            int d = TPM::t2s[S][j][1];
+
+            int e = s.col[j] + i;
+
+            s.k[0][e] = PHM::s2ph[a][d] + n_ph*PHM::s2ph[c][b];
+            s.k[1][e] = PHM::s2ph[b][c] + n_ph*PHM::s2ph[d][a];
+            s.k[2][e] = PHM::s2ph[b][d] + n_ph*PHM::s2ph[c][a];
+            s.k[3][e] = PHM::s2ph[a][c] + n_ph*PHM::s2ph[d][b];
+
+            if(b == d){
+
+               s.k[4][e] = a + c*m;
+               s.c[0][e] = 1.0;
+
+            }
+
+            if(a == c){
+
+               s.k[5][e] = b + d*m;
+               s.c[1][e] = 1.0;
+
+            }
+
+            if(a == d){
+
+               s.k[6][e] = b + c*m;
+               s.c[2][e] = sign;
+
+            }
+
+            if(b == c){
+
+               s.k[7][e] = a + d*m;
+               s.c[3][e] = sign;
+
+            }
+
+            s.c[4][e] = (S == 0 && a == b) ? std::sqrt(2.0) : 1.0;
+            s.c[5][e] = (S == 0 && c == d) ? std::sqrt(2.0) : 1.0;
+
+         }
+
+   }
+
+   //SPM::bar(TPM): for every element (a,c) the m terms of the sum over b, term b of the elements of a column is stored after term b - 1
+   b.init(m,2,3,m);
+
+   for(int c = 0;c < m;++c)
+      for(int a = 0;a <= c;++a)
+         for(int l = 0;l < m;++l){
+
+            int e = b.col[c] + l*b.n_pad[c] + a;
+
+            b.k[0][e] = TPM::s2t[0][a][l] + n_tp[0]*TPM::s2t[0][c][l];
+
+            b.c[0][e] = (a == l) ? std::sqrt(2.0) : 1.0;
+            b.c[1][e] = (c == l) ? std::sqrt(2.0) : 1.0;
+
+            if(a != l && c != l){
+
+               int phase = 1;
+
+               if(a > l)
+                  phase *= -1;
+               if(c > l)
+                  phase *= -1;
+
+               b.k[1][e] = TPM::s2t[1][a][l] + n_tp[1]*TPM::s2t[1][c][l];
+               b.c[2][e] = 3.0*phase;
+
+            }
+
+         }
+
+   if(!cache_dir.empty())
+      save();
+
+}
+
+/**
+ * Destructor
+ */
+MapStreams::~MapStreams(){
+
+   if(map != 0)
+      munmap(map,map_bytes);
+
+}
+
+/**
+ * @param i index of the stream: q[0], q[1], g[0], g[1], g_down[0], g_down[1] and b
+ * @return stream i, in the order of the cache file
+ */
+MapStreams::Stream &MapStreams::stream(int i){
+
+   Stream *all[7] = {&q[0],&q[1],&g[0],&g[1],&g_down[0],&g_down[1],&b};
+
+   return *all[i];
+
+}
+
+/**
+ * Walk through the arrays of the streams in the order of the cache file, after the header
+ * @param base start of the image of the file, 0 to only calculate its size
+ * @param save true: copy the arrays to the image, false: let the arrays point into the image
+ * @return the size of the image in bytes
+ */
+size_t MapStreams::image(char *base,bool save){
+
+   size_t offset = next(8,header_ints*sizeof(int));
+
+   for(int i = 0;i < 7;++i){
+
+      Stream &s = stream(i);
+
+      int **ints[2] = {&s.col,&s.n_pad};
+
+      for(int l = 0;l < 2;++l){
+
+         if(base != 0){
+
+            if(save)
+               memcpy(base + offset,*ints[l],s.n*sizeof(int));
+            else
+               *ints[l] = (int *) (base + offset);
+
+         }
+
+         offset = next(offset,s.n*sizeof(int));
+
+      }
+
+      for(int t = 0;t < s.n_k;++t){
+
+         if(base != 0){
+
+            if(save)
+               memcpy(base + offset,s.k[t],s.size*sizeof(int));
+            else
+               s.k[t] = (int *) (base + offset);
+
+         }
+
+         offset = next(offset,s.size*sizeof(int));
+
+      }
+
+      for(int t = 0;t < s.n_c;++t){
+
+         if(base != 0){
+
+            if(save)
+               memcpy(base + offset,s.c[t],s.size*sizeof(double));
+            else
+               s.c[t] = (double *) (base + offset);
+
+         }
+
+         offset = next(offset,s.size*sizeof(double));
+
+      }
+
+   }
+
+   return offset;
+
+}
+
+/**
+ * @return the name of the cache file for this M
+ */
+std::string MapStreams::cache_file() const{
+
+   return cache_dir + "/map_streams_M" + std::to_string(M) + "_v" + std::to_string(cache_version) + ".bin";
+
+}
+
+/**
+ * Map the cache file read-only and let the streams point into it
+ * @return false if there is no valid cache file for this M, the streams have to be constructed then
+ */
+bool MapStreams::load(){
+
+   int fd = open(cache_file().c_str(),O_RDONLY);
+
+   if(fd == -1)
+      return false;
+
+   struct stat st;
+
+   size_t bytes = 0;
+
+   if(fstat(fd,&st) == 0)
+      bytes = st.st_size;
+
+   char *ptr = 0;
+
+   if(bytes > 8 + header_ints*sizeof(int)){
+
+      ptr = (char *) mmap(0,bytes,PROT_READ,MAP_SHARED,fd,0);
+
+      if(ptr == MAP_FAILED)
+         ptr = 0;
+
+   }
+
+   close(fd);
+
+   if(ptr == 0)
+      return false;
+
+   const int *header = (const int *) (ptr + 8);
+
+   bool valid = (memcmp(ptr,"spinbpms",8) == 0 && header[0] == cache_version && header[1] == M && header[2] == (int)sizeof(int) && header[3] == (int)sizeof(double));
+
+   for(int i = 0;i < 7 && valid;++i){
+
+      const int *h = header + 4 + 4*i;
+
+      if(h[0] < 0 || h[1] < 0 || h[2] < 0 || h[2] > 8 || h[3] < 0 || h[3] > 8)
+         valid = false;
+      else{
+
+         Stream &s = stream(i);
+
+         s.n = h[0];
+         s.size = h[1];
+         s.n_k = h[2];
+         s.n_c = h[3];
+
+      }
+
+   }
+
+   //a file that was truncated or written by another version is constructed again
+   if(!valid || image(0,false) != bytes){
+
+      munmap(ptr,bytes);
+
+      return false;
+
+   }
+
+   for(int i = 0;i < 7;++i){
+
+      Stream &s = stream(i);
+
+      s.mapped = true;
+
+      for(int t = 0;t < 8;++t){
+
+         s.k[t] = 0;
+         s.c[t] = 0;
+
+      }
+
+   }
+
+   image(ptr,false);
+
+   map = ptr;
+   map_bytes = bytes;
+
+   return true;
+
+}
+
+/**
+ * Write the streams to the cache file. The file is written under a temporary name and renamed, so other processes never see a partial file.
+ * When it can't be written the program goes on without cache.
+ */
+void MapStreams::save(){
+
+   size_t bytes = image(0,true);
+
+   char *buffer = new char [bytes]();
+
+   memcpy(buffer,"spinbpms",8);
+
+   int *header = (int *) (buffer + 8);
+
+   header[0] = cache_version;
+   header[1] = M;
+   header[2] = sizeof(int);
+   header[3] = sizeof(double);
+
+   for(int i = 0;i < 7;++i){
+
+      Stream &s = stream(i);
+
+      int *h = header + 4 + 4*i;
+
+      h[0] = s.n;
+      h[1] = s.size;
+      h[2] = s.n_k;
+      h[3] = s.n_c;
+
+   }
+
+   image(buffer,true);
+
+   std::string name = cache_file();
+   std::string tmp = name + ".XXXXXX";
+
+   int fd = mkstemp(&tmp[0]);
+
+   bool ok = (fd != -1);
+
+   size_t done = 0;
+
+   while(ok && done < bytes){
+
+      ssize_t w = write(fd,buffer + done,bytes - done);
+
+      if(w <= 0)
+         ok = false;
+      else
+         done += w;
+
+   }
+
+   if(fd != -1)
+      close(fd);
+
+   if(ok){
+
+      //the file is only read
+      chmod(tmp.c_str(),0444);
+
+      ok = (rename(tmp.c_str(),name.c_str()) == 0);
+
+   }
+
+   if(!ok){
+
+      std::cerr << "MapStreams: cannot write the cache file " << name << endl;
+
+      if(fd != -1)
+         unlink(tmp.c_str());
+
+   }
+
+   delete [] buffer;
+
+}
+
+/**
+ * @return the widest instruction set the processor supports: 2 for AVX-512, 1 for AVX2, 0 otherwise
+ */
+int MapStreams::detect(){
+
+#ifdef __x86_64__
+
+   __builtin_cpu_init();
+
+   if(__builtin_cpu_supports("avx512f"))
+      return 2;
+
+   if(__builtin_cpu_supports("avx2"))
+      return 1;
+
+#endif
+
+   return 0;
+
+}
+
+/**
+ * Choose the instruction set of the map kernels, instead of the widest one the processor supports
+ * @param name "scalar", "avx2", "avx512" or "auto"
+ * @return false if the name is unknown or the processor doesn't support the instruction set
+ */
+bool MapStreams::set_isa(const char *name){
+
+   int max = detect();
+
+   if(strcmp(name,"auto") == 0){
+
+      isa = max;
+
+      return true;
+
+   }
+
+   for(int i = 0;i < 3;++i)
+      if(strcmp(name,isa_names[i]) == 0 && i <= max){
+
+         isa = i;
+
+         return true;
+
+      }
+
+   return false;
+
+}
+
+/**
+ * @return the name of the instruction set of the map kernels
+ */
+const char *MapStreams::isa_name(){
+
+   if(isa < 0)
+      isa = detect();
+
+   return isa_names[isa];
+
+}
+
+/**
+ * Keep the streams in cache files in a directory
+ * @param dir the directory, 0 or an empty string for no cache
+ */
+void MapStreams::set_cache(const char *dir){
+
+   cache_dir = (dir == 0) ? "" : dir;
+
+}
+
+/**
+ * @param M dimension of the sp space
+ * @return the streams for sp dimension M, constructed the first time, or 0 when the scalar kernels are used
+ */
+const MapStreams *MapStreams::get(int M){
+
+   const MapStreams *ms = 0;
+
+   #pragma omp critical(map_streams)
+   {
+
+      if(isa < 0)
+         isa = detect();
+
+      if(isa > 0){
+
+         if((int)streams.size() <= M)
+            streams.resize(M + 1);
+
+         if(!streams[M])
+            streams[M].reset(new MapStreams(M));
+
+         ms = streams[M].get();
+
+      }
+
+   }
+
+   return ms;
+
+}
+
+/**
+ * The Q-like map TPM::Q(A,ward,spm,tpm_d) on block S
+ * @param S the spin of the block
+ * @param A factor in front of the two particle piece of the map
+ * @param ward the np part
+ * @param spm the elements of the sp part
+ * @param tpm_d the elements of block S of the input TPM
+ * @param out the elements of block S of the output TPM, only the upper triangle is filled
+ * @param node the NUMA node of the output block, the columns are tasks on its threads (see Numa::run)
+ */
+void MapStreams::Q(int S,double A,double ward,const double *spm,const double *tpm_d,double *out,int node) const{
+
+#ifdef __x86_64__
+
+   if(isa == 2)
+      Q_avx512(S,A,ward,spm,tpm_d,out,node);
+   else
+      Q_avx2(S,A,ward,spm,tpm_d,out,node);
+
+#endif
+
+}
+
+/**
+ * The G map PHM::G(spm,tpm) on block S
+ * @param S the spin of the block
+ * @param spm the elements of the SPM of tpm, scaled with 1/(N-1)
+ * @param tpm the elements of the two blocks of the input TPM
+ * @param out the elements of block S of the output PHM, only the upper triangle is filled
+ * @param node the NUMA node of the output block, the columns are tasks on its threads (see Numa::run)
+ */
+void MapStreams::G(int S,const double *spm,const double * const *tpm,double *out,int node) const{
+
+#ifdef __x86_64__
+
+   if(isa == 2)
+      G_avx512(S,spm,tpm,out,node);
+   else
+      G_avx2(S,spm,tpm,out,node);
+
+#endif
+
+}
+
+/**
+ * The G down map TPM::G(phm) on block S
+ * @param S the spin of the block
+ * @param c_0 the factor of the S = 0 block of the PHM: its degeneracy times the 6j symbol
+ * @param c_1 the factor of the S = 1 block of the PHM
+ * @param spm the elements of the SPM of phm, scaled with 1/(N-1)
+ * @param phm the elements of the two blocks of the input PHM
+ * @param out the elements of block S of the output TPM, only the upper triangle is filled
+ */
+void MapStreams::G_down(int S,double c_0,double c_1,const double *spm,const double * const *phm,double *out) const{
+
+#ifdef __x86_64__
+
+   if(isa == 2)
+      G_down_avx512(S,c_0,c_1,spm,phm,out);
+   else
+      G_down_avx2(S,c_0,c_1,spm,phm,out);
+
+#endif
+
+}
+
+/**
+ * SPM::bar(scale,tpm)
+ * @param scale the factor of the SPM
+ * @param tpm the elements of the two blocks of the input TPM
+ * @param out the elements of the SPM, only the upper triangle is filled
+ */
+void MapStreams::bar(double scale,const double * const *tpm,double *out) const{
+
+#ifdef __x86_64__
+
+   if(isa == 2)
+      bar_avx512(scale,tpm,out);
+   else
+      bar_avx2(scale,tpm,out);
+
+#endif
+
+}
+
+#ifdef __x86_64__
+
+namespace{
+
+   /**
+    * @param rem number of elements that are left in the column
+    * @return AVX2 mask of the first min(rem,4) lanes
+    */
+   __attribute__((target("avx2")))
+   inline __m256i mask_avx2(int rem){
+
+      return _mm256_set_epi64x(rem > 3 ? -1 : 0,rem > 2 ? -1 : 0,rem > 1 ? -1 : 0,-1);
+
+   }
+
+   /**
+    * @param rem number of elements that are left in the column
+    * @return AVX-512 mask of the first min(rem,8) lanes
+    */
+   inline __mmask8 mask_avx512(int rem){
+
+      return (rem >= 8) ? (__mmask8) 0xFF : (__mmask8) ((1 << rem) - 1);
+
+   }
+
+   /**
+    * Gather 4 doubles. The unmasked intrinsic leaves the source operand of the masked instruction undefined, which gives
+    * -Wmaybe-uninitialized warnings in the headers of GCC at -O2, so the source is zeroed here and all lanes are enabled.
+    * @param base the array that is gathered from
+    * @param k the 4 indices
+    */
+   __attribute__((target("avx2")))
+   inline __m256d gather_avx2(const double *base,const int *k){
+
+      return _mm256_mask_i32gather_pd(_mm256_setzero_pd(),base,_mm_loadu_si128((const __m128i *) k),_mm256_castsi256_pd(_mm256_set1_epi64x(-1)),8);
+
+   }
+
+   /**
+    * Gather 8 doubles, see gather_avx2
+    * @param base the array that is gathered from
+    * @param k the 8 indices
+    */
+   __attribute__((target("avx512f")))
+   inline __m512d gather_avx512(const double *base,const int *k){
+
+      return _mm512_mask_i32gather_pd(_mm512_setzero_pd(),(__mmask8) 0xFF,_mm256_loadu_si256((const __m256i *) k),base,8);
+
+   }
+
+}
+
+//the column j has j + 1 elements: every column is a task on the node of the output block (see Numa::run), the long columns are started first
+
+__attribute__((target("avx2")))
+void MapStreams::Q_avx2(int S,double A,double ward,const double *spm,const double *tpm_d,double *out,int node) const{
+
+   const Stream *s = &q[S];
+
+   int n = s->n;
+
+   Numa::run(n,node,[&](int jj) __attribute__((target("avx2"))) {
+
+      int j = n - 1 - jj;
+
+      for(int i = 0;i <= j;i += 4){
+
+         int e = s->col[j] + i;
+
+         __m256i mask = mask_avx2(j + 1 - i);
+
+         __m256d x = _mm256_mul_pd(_mm256_set1_pd(A),_mm256_maskload_pd(tpm_d + j*n + i,mask));
+
+         x = _mm256_add_pd(x,_mm256_mul_pd(_mm256_loadu_pd(s->c[4] + e),_mm256_set1_pd(ward)));
+
+         for(int t = 0;t < 4;++t){
+
+            __m256d v = gather_avx2(spm,s->k[t] + e);
+
+            x = _mm256_sub_pd(x,_mm256_mul_pd(_mm256_loadu_pd(s->c[t] + e),v));
+
+         }
+
+         _mm256_maskstore_pd(out + j*n + i,mask,x);
+
+      }
+
+   });
+
+}
+
+__attribute__((target("avx512f")))
+void MapStreams::Q_avx512(int S,double A,double ward,const double *spm,const double *tpm_d,double *out,int node) const{
+
+   const Stream *s = &q[S];
+
+   int n = s->n;
+
+   Numa::run(n,node,[&](int jj) __attribute__((target("avx512f"))) {
+
+      int j = n - 1 - jj;
+
+      for(int i = 0;i <= j;i += 8){
+
+         int e = s->col[j] + i;
+
+         __mmask8 mask = mask_avx512(j + 1 - i);
+
+         __m512d x = _mm512_mul_pd(_mm512_set1_pd(A),_mm512_maskz_loadu_pd(mask,tpm_d + j*n + i));
+
+         x = _mm512_add_pd(x,_mm512_mul_pd(_mm512_loadu_pd(s->c[4] + e),_mm512_set1_pd(ward)));
+
+         for(int t = 0;t < 4;++t){
+
+            __m512d v = gather_avx512(spm,s->k[t] + e);
+
+            x = _mm512_sub_pd(x,_mm512_mul_pd(_mm512_loadu_pd(s->c[t] + e),v));
+
+         }
+
+         _mm512_mask_storeu_pd(out + j*n + i,mask,x);
+
+      }
+
+   });
+
+}
+
+__attribute__((target("avx2")))
+void MapStreams::G_avx2(int S,const double *spm,const double * const *tpm,double *out,int node) const{
+
+   const Stream *s = &g[S];
+
+   int n = s->n;
+
+   const double *tp_0 = tpm[0];
+   const double *tp_1 = tpm[1];
+
+   Numa::run(n,node,[&](int jj) __attribute__((target("avx2"))) {
+
+      int j = n - 1 - jj;
+
+      for(int i = 0;i <= j;i += 4){
+
+         int e = s->col[j] + i;
+
+         __m256d t_0 = gather_avx2(tp_0,s->k[0] + e);
+         __m256d t_1 = gather_avx2(tp_1,s->k[1] + e);
+
+         __m256d x = _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(s->c[0] + e),t_0),_mm256_mul_pd(_mm256_loadu_pd(s->c[1] + e),t_1));
+
+         x = _mm256_mul_pd(x,_mm256_loadu_pd(s->c[2] + e));
+         x = _mm256_mul_pd(x,_mm256_loadu_pd(s->c[3] + e));
+
+         __m256d v = gather_avx2(spm,s->k[2] + e);
+
+         x = _mm256_add_pd(x,_mm256_mul_pd(_mm256_loadu_pd(s->c[4] + e),v));
+
+         _mm256_maskstore_pd(out + j*n + i,mask_avx2(j + 1 - i),x);
+
+      }
+
+   });
+
+}
+
+__attribute__((target("avx512f")))
+void MapStreams::G_avx512(int S,const double *spm,const double * const *tpm,double *out,int node) const{
+
+   const Stream *s = &g[S];
+
+   int n = s->n;
+
+   const double *tp_0 = tpm[0];
+   const double *tp_1 = tpm[1];
+
+   Numa::run(n,node,[&](int jj) __attribute__((target("avx512f"))) {
+
+      int j = n - 1 - jj;
+
+      for(int i = 0;i <= j;i += 8){
+
+         int e = s->col[j] + i;
+
+         __m512d t_0 = gather_avx512(tp_0,s->k[0] + e);
+         __m512d t_1 = gather_avx512(tp_1,s->k[1] + e);
+
+         __m512d x = _mm512_sub_pd(_mm512_mul_pd(_mm512_loadu_pd(s->c[0] + e),t_0),_mm512_mul_pd(_mm512_loadu_pd(s->c[1] + e),t_1));
+
+         x = _mm512_mul_pd(x,_mm512_loadu_pd(s->c[2] + e));
+         x = _mm512_mul_pd(x,_mm512_loadu_pd(s->c[3] + e));
+
+         __m512d v = gather_avx512(spm,s->k[2] + e);
+
+         x = _mm512_add_pd(x,_mm512_mul_pd(_mm512_loadu_pd(s->c[4] + e),v));
+
+         _mm512_mask_storeu_pd(out + j*n + i,mask_avx512(j + 1 - i),x);
+
+      }
+
+   });
+
+}
+
+__attribute__((target("avx2")))
+void MapStreams::G_down_avx2(int S,double c_0,double c_1,const double *spm,const double * const *phm,double *out) const{
+
+   const Stream *s = &g_down[S];
+
+   int n = s->n;
+
+   const double *ph[2] = {phm[0],phm[1]};
+   double c_Z[2] = {c_0,c_1};
+
+   #pragma omp taskloop firstprivate(s,spm,ph,c_Z,out) grainsize(1)
+   for(int jj = 0;jj < n;++jj){
+
+      int j = n - 1 - jj;
+
+      __m256d sign = _mm256_set1_pd(1 - 2*S);
+
+      for(int i = 0;i <= j;i += 4){
+
+         int e = s->col[j] + i;
+
+         __m256d x = _mm256_setzero_pd();
+
+         //ph part
+         for(int Z = 0;Z < 2;++Z){
+
+            __m256d v = _mm256_add_pd(gather_avx2(ph[Z],s->k[0] + e),
+                  gather_avx2(ph[Z],s->k[1] + e));
+
+            v = _mm256_add_pd(v,_mm256_mul_pd(sign,gather_avx2(ph[Z],s->k[2] + e)));
+            v = _mm256_add_pd(v,_mm256_mul_pd(sign,gather_avx2(ph[Z],s->k[3] + e)));
+
+            x = _mm256_sub_pd(x,_mm256_mul_pd(_mm256_set1_pd(c_Z[Z]),v));
+
+         }
+
+         //4 sp parts
+         for(int t = 0;t < 4;++t){
+
+            __m256d v = gather_avx2(spm,s->k[4 + t] + e);
+
+            x = _mm256_add_pd(x,_mm256_mul_pd(_mm256_loadu_pd(s->c[t] + e),v));
+
+         }
+
+         //norm of the basisset
+         x = _mm256_div_pd(x,_mm256_loadu_pd(s->c[4] + e));
+         x = _mm256_div_pd(x,_mm256_loadu_pd(s->c[5] + e));
+
+         _mm256_maskstore_pd(out + j*n + i,mask_avx2(j + 1 - i),x);
+
+      }
+
+   }
+
+}
+
+__attribute__((target("avx512f")))
+void MapStreams::G_down_avx512(int S,double c_0,double c_1,const double *spm,const double * const *phm,double *out) const{
+
+   const Stream *s = &g_down[S];
+
+   int n = s->n;
+
+   const double *ph[2] = {phm[0],phm[1]};
+   double c_Z[2] = {c_0,c_1};
+
+   #pragma omp taskloop firstprivate(s,spm,ph,c_Z,out) grainsize(1)
+   for(int jj = 0;jj < n;++jj){
+
+      int j = n - 1 - jj;
+
+      __m512d sign = _mm512_set1_pd(1 - 2*S);
+
+      for(int i = 0;i <= j;i += 8){
+
+         int e = s->col[j] + i;
+
+         __m512d x = _mm512_setzero_pd();
+
+         //ph part
+         for(int Z = 0;Z < 2;++Z){
+
+            __m512d v = _mm512_add_pd(gather_avx512(ph[Z],s->k[0] + e),
+                  gather_avx512(ph[Z],s->k[1] + e));
+
+            v = _mm512_add_pd(v,_mm512_mul_pd(sign,gather_avx512(ph[Z],s->k[2] + e)));
+            v = _mm512_add_pd(v,_mm512_mul_pd(sign,gather_avx512(ph[Z],s->k[3] + e)));
+
+            x = _mm512_sub_pd(x,_mm512_mul_pd(_mm512_set1_pd(c_Z[Z]),v));
+
+         }
+
+         //4 sp parts
+         for(int t = 0;t < 4;++t){
+
+            __m512d v = gather_avx512(spm,s->k[4 + t] + e);
+
+            x = _mm512_add_pd(x,_mm512_mul_pd(_mm512_loadu_pd(s->c[t] + e),v));
+
+         }
+
+         //norm of the basisset
+         x = _mm512_div_pd(x,_mm512_loadu_pd(s->c[4] + e));
+         x = _mm512_div_pd(x,_mm512_loadu_pd(s->c[5] + e));
+
+         _mm512_mask_storeu_pd(out + j*n + i,mask_avx512(j + 1 - i),x);
+
+      }
+
+   }
+
+}
+
+//the SPM is small: no tasks
+
+__attribute__((target("avx2")))
+void MapStreams::bar_avx2(double scale,const double * const *tpm,double *out) const{
+
+   const Stream *s = &b;
+
+   int m = s->n;
+
+   for(int j = 0;j < m;++j)
+      for(int i = 0;i <= j;i += 4){
+
+         __m256d x = _mm256_setzero_pd();
+
+         for(int l = 0;l < m;++l){
+
+            int e = s->col[j] + l*s->n_pad[j] + i;
+
+            //S = 0 stuk
+            __m256d w = gather_avx2(tpm[0],s->k[0] + e);
+
+            w = _mm256_mul_pd(w,_mm256_loadu_pd(s->c[0] + e));
+            w = _mm256_mul_pd(w,_mm256_loadu_pd(s->c[1] + e));
+
+            x = _mm256_add_pd(x,w);
+
+            //S = 1 stuk
+            __m256d v = gather_avx2(tpm[1],s->k[1] + e);
+
+            x = _mm256_add_pd(x,_mm256_mul_pd(_mm256_loadu_pd(s->c[2] + e),v));
+
+         }
+
+         x = _mm256_mul_pd(x,_mm256_set1_pd(0.5*scale));
+
+         _mm256_maskstore_pd(out + j*m + i,mask_avx2(j + 1 - i),x);
+
+      }
+
+}
+
+__attribute__((target("avx512f")))
+void MapStreams::bar_avx512(double scale,const double * const *tpm,double *out) const{
+
+   const Stream *s = &b;
+
+   int m = s->n;
+
+   for(int j = 0;j < m;++j)
+      for(int i = 0;i <= j;i += 8){
+
+         __m512d x = _mm512_setzero_pd();
+
+         for(int l = 0;l < m;++l){
+
+            int e = s->col[j] + l*s->n_pad[j] + i;
+
+            //S = 0 stuk
+            __m512d w = gather_avx512(tpm[0],s->k[0] + e);
+
+            w = _mm512_mul_pd(w,_mm512_loadu_pd(s->c[0] + e));
+            w = _mm512_mul_pd(w,_mm512_loadu_pd(s->c[1] + e));
+
+            x = _mm512_add_pd(x,w);
+
+            //S = 1 stuk
+            __m512d v = gather_avx512(tpm[1],s->k[1] + e);
+
+            x = _mm512_add_pd(x,_mm512_mul_pd(_mm512_loadu_pd(s->c[2] + e),v));
+
+         }
+
+         x = _mm512_mul_pd(x,_mm512_set1_pd(0.5*scale));
+
+         _mm512_mask_storeu_pd(out + j*m + i,mask_avx512(j + 1 - i),x);
+
+      }
+
+}
+
+#endif
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -1,6 +1,10 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <string>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
 
 using std::endl;
 using std::ostream;
@@ -9,16 +13,28 @@ using std::ifstream;
 
 #include "include.h"
 
+int Matrix::sign_dim = 0;
+
+int Matrix::eig_dim = 100;
+
+int Matrix::mmap_dim = 0;
+
+std::string Matrix::mmap_dir = "/tmp";
+
 /**
  * constructor 
  * @param n dimension of the matrix
+ * @param scratch if true the matrix is a temporary one and its elements are never stored out-of-core, see allocate
  */
-Matrix::Matrix(int n){
+Matrix::Matrix(int n,bool scratch){
 
    this->n = n;
 
    matrix = new double * [n];
-   matrix[0] = new double [n*n];
+   matrix[0] = allocate(n,mapped,scratch);
+
+   node = -1;
+   remote = false;
 
    for(int i = 1;i < n;++i)
       matrix[i] = matrix[i - 1] + n;
@@ -34,7 +50,10 @@ Matrix::Matrix(const Matrix &mat_copy){
    this->n = mat_copy.n;
 
    matrix = new double * [n];
-   matrix[0] = new double [n*n];
+   matrix[0] = allocate(n,mapped);
+
+   node = -1;
+   remote = false;
 
    for(int i = 1;i < n;++i)
       matrix[i] = matrix[i - 1] + n;
@@ -58,7 +77,10 @@ Matrix::Matrix(const char *filename){
    input >> this->n;
 
    matrix = new double * [n];
-   matrix[0] = new double [n*n];
+   matrix[0] = allocate(n,mapped);
+
+   node = -1;
+   remote = false;
 
    for(int i = 1;i < n;++i)
       matrix[i] = matrix[i - 1] + n;
@@ -71,13 +93,115 @@ Matrix::Matrix(const char *filename){
 
 }
 
+/**
+ * move constructor: takes over the memory of mat_move, which is left empty and can only be destructed or assigned to: a copy assignment
+ * allocates new memory for it, a move assignment takes over the memory of the other matrix.
+ * @param mat_move The matrix whose memory is taken
+ */
+Matrix::Matrix(Matrix &&mat_move){
+
+   this->n = mat_move.n;
+
+   matrix = mat_move.matrix;
+   mapped = mat_move.mapped;
+   node = mat_move.node;
+   remote = mat_move.remote;
+
+   mat_move.n = 0;
+   mat_move.matrix = 0;
+   mat_move.mapped = false;
+   mat_move.node = -1;
+   mat_move.remote = false;
+
+}
+
 /**
  * Destructor
  */
 Matrix::~Matrix(){
 
-   delete [] matrix[0];
-   delete [] matrix;
+   //a matrix that has been moved has no memory left
+   if(matrix != 0){
+
+      deallocate(matrix[0],n,mapped);
+      delete [] matrix;
+
+   }
+
+}
+
+/**
+ * Allocate the memory for the elements of an n x n matrix. Matrices with dimension larger than or equal to mmap_dim are backed by an unlinked
+ * file in mmap_dir, so that the kernel can page them out to disk when they don't fit in memory. Scratch matrices are always in memory:
+ * they only live during one call, so a file would only add the cost of creating it and of writing their pages back to disk.
+ * @param n dimension of the matrix
+ * @param mapped output: true if the memory is a file mapping
+ * @param scratch true for a temporary matrix
+ * @return pointer to the n*n elements
+ */
+double *Matrix::allocate(int n,bool &mapped,bool scratch){
+
+   mapped = (!scratch && mmap_dim > 0 && n >= mmap_dim);
+
+   if(!mapped)
+      return new double [n*n];
+
+   size_t bytes = (size_t)n*n*sizeof(double);
+
+   std::string name = mmap_dir + "/spin_bp_XXXXXX";
+
+   char *filename = new char [name.size() + 1];
+   name.copy(filename,name.size());
+   filename[name.size()] = '\0';
+
+   int fd = mkstemp(filename);
+
+   if(fd == -1){
+
+      std::cerr << "Matrix: cannot create a file in " << mmap_dir << " for out-of-core storage" << endl;
+      exit(1);
+
+   }
+
+   //the file disappears as soon as the mapping is removed
+   unlink(filename);
+
+   delete [] filename;
+
+   if(ftruncate(fd,bytes) != 0){
+
+      std::cerr << "Matrix: cannot reserve " << bytes << " bytes in " << mmap_dir << " for out-of-core storage" << endl;
+      exit(1);
+
+   }
+
+   void *ptr = mmap(0,bytes,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+
+   close(fd);
+
+   if(ptr == MAP_FAILED){
+
+      std::cerr << "Matrix: mmap of " << bytes << " bytes failed" << endl;
+      exit(1);
+
+   }
+
+   return (double *) ptr;
+
+}
+
+/**
+ * Free memory that was allocated with allocate
+ * @param ptr pointer to the elements
+ * @param n dimension of the matrix
+ * @param mapped true if the memory is a file mapping
+ */
+void Matrix::deallocate(double *ptr,int n,bool mapped){
+
+   if(mapped)
+      munmap(ptr,(size_t)n*n*sizeof(double));
+   else
+      delete [] ptr;
 
 }
 
@@ -87,6 +211,23 @@ Matrix::~Matrix(){
  */
 Matrix &Matrix::operator=(const Matrix &matrix_copy){
 
+   //a matrix that has been moved gets new memory
+   if(matrix == 0){
+
+      n = matrix_copy.n;
+
+      matrix = new double * [n];
+      matrix[0] = allocate(n,mapped);
+
+      for(int i = 1;i < n;++i)
+         matrix[i] = matrix[i - 1] + n;
+
+   }
+
+   //the block of another MPI rank stays zero, see set_remote
+   if(remote)
+      return *this;
+
    int dim = n*n;
    int incx = 1;
    int incy = 1;
@@ -97,12 +238,137 @@ Matrix &Matrix::operator=(const Matrix &matrix_copy){
 
 }
 
+/**
+ * move assignment: swaps the memory of (*this) and matrix_move, no numbers are copied
+ * @param matrix_move The matrix you want to be moved into this
+ */
+Matrix &Matrix::operator=(Matrix &&matrix_move){
+
+   this->swap(matrix_move);
+
+   return *this;
+
+}
+
+/**
+ * Evaluate the linear combination coef[0] term[0] + ... + coef[K-1] term[K-1] into (*this), see LinComb. (*this) may be one of the terms.
+ * This is one fused loop over the memory, which the compiler vectorizes in an optimized build.
+ * @param K number of terms
+ * @param coef the coefficients
+ * @param term the terms, matrices with the same dimension as (*this)
+ */
+Matrix &Matrix::lincomb(int K,const double *coef,const Matrix * const *term){
+
+   //the block of another MPI rank stays zero, see set_remote
+   if(remote)
+      return *this;
+
+   int dim = n*n;
+
+   double *x = matrix[0];
+
+   //the most common lengths get their own loop, the elements are independent even when (*this) is a term, so it is vectorized
+   if(K == 0){
+
+      #pragma omp simd
+      for(int i = 0;i < dim;++i)
+         x[i] = 0.0;
+
+   }
+   else if(K == 1){
+
+      double a = coef[0];
+      const double *y = term[0]->matrix[0];
+
+      #pragma omp simd
+      for(int i = 0;i < dim;++i)
+         x[i] = a*y[i];
+
+   }
+   else if(K == 2){
+
+      double a = coef[0];
+      double b = coef[1];
+
+      const double *y = term[0]->matrix[0];
+      const double *z = term[1]->matrix[0];
+
+      #pragma omp simd
+      for(int i = 0;i < dim;++i)
+         x[i] = a*y[i] + b*z[i];
+
+   }
+   else if(K == 3){
+
+      double a = coef[0];
+      double b = coef[1];
+      double c = coef[2];
+
+      const double *y = term[0]->matrix[0];
+      const double *z = term[1]->matrix[0];
+      const double *w = term[2]->matrix[0];
+
+      #pragma omp simd
+      for(int i = 0;i < dim;++i)
+         x[i] = a*y[i] + b*z[i] + c*w[i];
+
+   }
+   else{
+
+      for(int i = 0;i < dim;++i){
+
+         double ward = 0.0;
+
+         for(int k = 0;k < K;++k)
+            ward += coef[k] * term[k]->matrix[0][i];
+
+         x[i] = ward;
+
+      }
+
+   }
+
+   return *this;
+
+}
+
+/**
+ * Swap the content of (*this) and matrix_sw by swapping the pointers to the memory, O(1)
+ * @param matrix_sw The matrix to swap with
+ */
+void Matrix::swap(Matrix &matrix_sw){
+
+   double **hulp = matrix;
+   matrix = matrix_sw.matrix;
+   matrix_sw.matrix = hulp;
+
+   int n_hulp = n;
+   n = matrix_sw.n;
+   matrix_sw.n = n_hulp;
+
+   bool m_hulp = mapped;
+   mapped = matrix_sw.mapped;
+   matrix_sw.mapped = m_hulp;
+
+   int node_hulp = node;
+   node = matrix_sw.node;
+   matrix_sw.node = node_hulp;
+
+   bool r_hulp = remote;
+   remote = matrix_sw.remote;
+   matrix_sw.remote = r_hulp;
+
+}
+
 /**
  * Make all the number in your matrix equal to the number a, e.g. usefull for initialization (Matrix M = 0)
  * @param a the number
  */
 Matrix &Matrix::operator=(double a){
 
+   if(remote)
+      return *this;
+
    for(int i = 0;i < n;++i)
       for(int j = 0;j < n;++j)
          matrix[j][i] = a;
@@ -210,6 +476,15 @@ double **Matrix::gMatrix(){
 
 }
 
+/**
+ * @return the underlying pointer to matrix, read only: for the map kernels that index the blocks directly
+ */
+const double * const *Matrix::gMatrix() const{
+
+   return matrix;
+
+}
+
 /**
  * @return the dimension of the matrix
  */
@@ -246,6 +521,30 @@ double Matrix::ddot(const Matrix &matrix_i) const{
 
 }
 
+/**
+ * Replace (*this) by matrix_i and return the distance between the old and the new (*this). The distance is calculated in a single
+ * read-only pass and the replacement is a swap, so matrix_i contains the old (*this) afterwards.
+ * @param matrix_i input matrix, contains the old (*this) on exit
+ * @return the squared Frobenius norm of (*this) - matrix_i before the swap
+ */
+double Matrix::update(Matrix &matrix_i){
+
+   double ward = 0.0;
+
+   for(int i = 0;i < n*n;++i){
+
+      double diff = matrix[0][i] - matrix_i.matrix[0][i];
+
+      ward += diff*diff;
+
+   }
+
+   this->swap(matrix_i);
+
+   return ward;
+
+}
+
 /**
  * Invert positive semidefinite symmetric matrix is stored in (*this), original matrix (*this) is destroyed
  */
@@ -396,6 +695,9 @@ Matrix &Matrix::mprod(const Matrix &A,const Matrix &B){
  */
 void Matrix::symmetrize(){
 
+   if(remote)
+      return;
+
    for(int i = 0;i < n;++i)
       for(int j = i + 1;j < n;++j)
          matrix[i][j] = matrix[j][i];
@@ -428,15 +730,168 @@ void Matrix::out(const char *filename) const{
 }
 
 /**
- * Seperate matrix into two matrices, a positive and negative semidefinite part.
+ * Cheap test for definiteness, without eigendecomposition. A matrix with a diagonal element of either sign is never definite.
+ * Otherwise the Gershgorin discs are checked first, and if they don't decide, a Cholesky decomposition of the matrix (or of minus
+ * the matrix) on a copy. A Cholesky decomposition costs about n^3/3 flops, a small fraction of a full dsyev.
+ * @return 1 if the matrix is positive definite, -1 if it is negative definite, 0 if it is indefinite or singular
+ */
+int Matrix::definite() const{
+
+   if(n == 0)
+      return 0;
+
+   int sign = 0;
+
+   if(matrix[0][0] > 0.0)
+      sign = 1;
+   else if(matrix[0][0] < 0.0)
+      sign = -1;
+   else
+      return 0;
+
+   for(int i = 1;i < n;++i)
+      if(sign * matrix[i][i] <= 0.0)
+         return 0;
+
+   //Gershgorin: every disc strictly on the right side of zero
+   bool gershgorin = true;
+
+   for(int i = 0;i < n && gershgorin;++i){
+
+      double radius = 0.0;
+
+      for(int j = 0;j < n;++j)
+         if(j != i)
+            radius += std::fabs(matrix[i][j]);
+
+      if(sign * matrix[i][i] <= radius)
+         gershgorin = false;
+
+   }
+
+   if(gershgorin)
+      return sign;
+
+   //Cholesky on a copy of sign * (*this)
+   double *A = new double [n*n];
+
+   for(int i = 0;i < n*n;++i)
+      A[i] = sign * matrix[0][i];
+
+   char uplo = 'U';
+
+   int info;
+   int dim = n;
+
+   dpotrf_(&uplo,&dim,A,&dim,&info);
+
+   delete [] A;
+
+   if(info == 0)
+      return sign;
+
+   return 0;
+
+}
+
+/**
+ * Seperate matrix into two matrices, a positive and negative semidefinite part. If the matrix is definite, see definite(), one
+ * of the parts is zero and the other one is the matrix itself, and no eigendecomposition is done. The matrix itself is destroyed,
+ * so the minus part can be stored in place: m may be (*this), which costs one scratch matrix during the call. (*this) keeps its storage.
+ * Blocks of dimension eig_dim and larger are decomposed in parallel with sep_pm_tiled.
  * @param p positive (plus) output part
- * @param m negative (minus) output part
+ * @param m negative (minus) output part, can be (*this)
+ * @param single if true the diagonalization is done in single precision on a float copy of the matrix, see sep_pm_single. It has no effect
+ * on blocks that use the sign iteration (dimension sign_dim and larger), which is always done in double precision.
+ * @param scale the minus part is returned multiplied with scale, so that a scaled m doesn't need an extra pass
+ * @param m_f if not 0, the factor F of the minus part m = F F^T is stored here when scale <= 0 and the number of negative eigenvalues is
+ * not larger than its maximal rank, else it is set to rank -1 (no factor). The sign iteration and a negative definite matrix never give a factor.
+ * @return 1 if the matrix was positive definite, -1 if it was negative definite, 0 if it was decomposed
  */
-void Matrix::sep_pm(Matrix &p,Matrix &m){
+int Matrix::sep_pm(Matrix &p,Matrix &m,bool single,double scale,LRMatrix *m_f){
 
-   //init:
-   p = 0;
-   m = 0;
+   int def = this->definite();
+
+   if(def == 1){
+
+      p = *this;
+      m = 0;
+
+      if(m_f != 0)
+         m_f->set_rank(0);
+
+      return 1;
+
+   }
+
+   if(def == -1){
+
+      p = 0;
+
+      m = *this;
+      m.dscal(scale);
+
+      if(m_f != 0)
+         m_f->set_rank(-1);
+
+      return -1;
+
+   }
+
+   if(sign_dim > 0 && n >= sign_dim){
+
+      //the sign iteration uses m as workspace, so it needs a copy of (*this) when they are the same
+      if(&m == this){
+
+         Matrix hulp(n,true);
+
+         hulp.bind(node);
+
+         hulp = *this;
+
+         hulp.sep_pm_sign(p,m,scale);
+
+      }
+      else
+         sep_pm_sign(p,m,scale);
+
+      if(m_f != 0)
+         m_f->set_rank(-1);
+
+      return 0;
+
+   }
+
+   if(single){
+
+      sep_pm_single(p,m,scale,m_f);
+
+      return 0;
+
+   }
+
+   if(eig_dim > 0 && n >= eig_dim){
+
+      sep_pm_tiled(p,m,scale,m_f);
+
+      return 0;
+
+   }
+
+   //when m is (*this) the matrix is diagonalized in a scratch copy, so that (*this) keeps its own storage: its NUMA node and out-of-core file
+   Matrix *hulp = 0;
+
+   if(&m == this){
+
+      hulp = new Matrix(n,true);
+
+      hulp->bind(node);
+
+      *hulp = *this;
+
+   }
+
+   double **vec = (hulp == 0) ? matrix : hulp->matrix;
 
    double *eigenvalues = new double [n];
 
@@ -450,18 +905,31 @@ void Matrix::sep_pm(Matrix &p,Matrix &m){
 
    int info;
 
-   dsyev_(&jobz,&uplo,&n,matrix[0],&n,eigenvalues,work,&lwork,&info);
+   dsyev_(&jobz,&uplo,&n,vec[0],&n,eigenvalues,work,&lwork,&info);
 
    delete [] work;
 
+   if(info != 0){
+
+      std::cerr << "Matrix: dsyev failed with info = " << info << " for a block of dimension " << n << endl;
+      exit(1);
+
+   }
+
+   //init:
+   p = 0;
+   m = 0;
+
    //fill the plus and minus matrix
    int i = 0;
 
    while(i < n && eigenvalues[i] < 0.0){
 
+      double ev = scale * eigenvalues[i];
+
       for(int j = 0;j < n;++j)
          for(int k = j;k < n;++k)
-            m(j,k) += eigenvalues[i] * matrix[i][j] * matrix[i][k];
+            m(j,k) += ev * vec[i][j] * vec[i][k];
 
       ++i;
 
@@ -473,7 +941,7 @@ void Matrix::sep_pm(Matrix &p,Matrix &m){
 
       for(int j = 0;j < n;++j)
          for(int k = j;k < n;++k)
-            p(j,k) += eigenvalues[i] * matrix[i][j] * matrix[i][k];
+            p(j,k) += eigenvalues[i] * vec[i][j] * vec[i][k];
 
       ++i;
 
@@ -481,6 +949,559 @@ void Matrix::sep_pm(Matrix &p,Matrix &m){
 
    p.symmetrize();
 
+   //the eigenvectors of the negative eigenvalues, scaled with sqrt(scale * eigenvalue), are the factor of m
+   if(m_f != 0){
+
+      int neg = 0;
+
+      while(neg < n && eigenvalues[neg] < 0.0)
+         ++neg;
+
+      if(scale <= 0.0 && neg <= m_f->gr_max()){
+
+         double *F = m_f->set_rank(neg);
+
+         for(int i = 0;i < neg;++i){
+
+            double scal = std::sqrt(scale * eigenvalues[i]);
+
+            for(int j = 0;j < n;++j)
+               F[i*n + j] = scal * vec[i][j];
+
+         }
+
+      }
+      else
+         m_f->set_rank(-1);
+
+   }
+
    delete [] eigenvalues;
 
+   delete hulp;
+
+   return 0;
+
+}
+
+/**
+ * Single precision version of sep_pm: the matrix is copied to floats and diagonalized with ssyevd, the positive and negative part
+ * are then constructed with ssyrk and copied back into the double precision output matrices. The result is only accurate to about 1.0e-7
+ * relative to the norm of the matrix. Most of the gain over the double precision version is in the ssyrk's, the eigensolver itself gains less.
+ * The float copy and the workspace of ssyevd, which is reused as the output of ssyrk, only live during the call. (*this) is left unchanged.
+ * @param p positive (plus) output part
+ * @param m negative (minus) output part
+ * @param scale the minus part is returned multiplied with scale
+ * @param m_f if not 0, the factor of the minus part is stored here (converted to double), see sep_pm
+ */
+void Matrix::sep_pm_single(Matrix &p,Matrix &m,double scale,LRMatrix *m_f){
+
+   //the minimal workspace of ssyevd with eigenvectors
+   int lwork = 1 + 6*n + 2*n*n;
+   int liwork = 3 + 5*n;
+
+   float *A = new float [n*n + n + lwork];
+   int *iwork = new int [liwork];
+
+   float *eigenvalues = A + n*n;
+   float *work = eigenvalues + n;
+
+   for(int i = 0;i < n*n;++i)
+      A[i] = matrix[0][i];
+
+   char jobz = 'V';
+   char uplo = 'U';
+
+   int info;
+
+   ssyevd_(&jobz,&uplo,&n,A,&n,eigenvalues,work,&lwork,iwork,&liwork,&info);
+
+   delete [] iwork;
+
+   if(info != 0){
+
+      std::cerr << "Matrix: ssyevd failed with info = " << info << " for a block of dimension " << n << endl;
+      exit(1);
+
+   }
+
+   //scale the eigenvectors with the square root of the absolute value of the eigenvalues
+   int neg = 0;
+
+   while(neg < n && eigenvalues[neg] < 0.0)
+      ++neg;
+
+   for(int i = 0;i < n;++i){
+
+      float scal = std::sqrt(std::fabs(eigenvalues[i]));
+
+      for(int j = 0;j < n;++j)
+         A[i*n + j] *= scal;
+
+   }
+
+   if(m_f != 0){
+
+      if(scale <= 0.0 && neg <= m_f->gr_max()){
+
+         double *F = m_f->set_rank(neg);
+
+         double scal = std::sqrt(-scale);
+
+         for(int i = 0;i < neg*n;++i)
+            F[i] = scal * A[i];
+
+      }
+      else
+         m_f->set_rank(-1);
+
+   }
+
+   //and construct the negative and positive part, in the workspace of ssyevd: lwork > n*n
+   float *C = work;
+
+   char trans = 'N';
+
+   float alpha = -scale;
+   float beta = 0.0;
+
+   if(neg > 0){
+
+      ssyrk_(&uplo,&trans,&n,&neg,&alpha,A,&n,&beta,C,&n);
+
+      for(int j = 0;j < n;++j)
+         for(int i = 0;i <= j;++i)
+            m.matrix[j][i] = C[j*n + i];
+
+      m.symmetrize();
+
+   }
+   else
+      m = 0;
+
+   int pos = n - neg;
+
+   alpha = 1.0;
+
+   if(pos > 0){
+
+      ssyrk_(&uplo,&trans,&n,&pos,&alpha,A + neg*n,&n,&beta,C,&n);
+
+      for(int j = 0;j < n;++j)
+         for(int i = 0;i <= j;++i)
+            p.matrix[j][i] = C[j*n + i];
+
+      p.symmetrize();
+
+   }
+   else
+      p = 0;
+
+   delete [] A;
+
+}
+
+/**
+ * Version of sep_pm for the largest blocks, which would otherwise be a serial bottleneck: the matrix is diagonalized with the divide and
+ * conquer eigensolver dsyevd, whose back transformation is done with matrix-matrix products, so that it uses all the BLAS threads that
+ * ThreadBudget gives to the block. The eigenvectors are then scaled with the square root of the absolute value of their eigenvalue,
+ * and the plus and minus part are constructed as F F^T with syrk_tiled, in tiles that are tasks, instead of with the scalar loops of sep_pm.
+ * The matrix itself is destroyed, m may be (*this).
+ * @param p positive (plus) output part
+ * @param m negative (minus) output part, can be (*this)
+ * @param scale the minus part is returned multiplied with scale
+ * @param m_f if not 0, the factor of the minus part is stored here, see sep_pm
+ */
+void Matrix::sep_pm_tiled(Matrix &p,Matrix &m,double scale,LRMatrix *m_f){
+
+   //as in sep_pm, (*this) keeps its storage when it is m
+   Matrix *hulp = 0;
+
+   if(&m == this){
+
+      hulp = new Matrix(n,true);
+
+      hulp->bind(node);
+
+      *hulp = *this;
+
+   }
+
+   double *vec = (hulp == 0) ? matrix[0] : hulp->matrix[0];
+
+   double *eigenvalues = new double [n];
+
+   char jobz = 'V';
+   char uplo = 'U';
+
+   //workspace query
+   int lwork = -1;
+   int liwork = -1;
+
+   double wopt;
+   int iwopt;
+
+   int info;
+
+   dsyevd_(&jobz,&uplo,&n,vec,&n,eigenvalues,&wopt,&lwork,&iwopt,&liwork,&info);
+
+   lwork = (int) wopt;
+   liwork = iwopt;
+
+   double *work = new double [lwork];
+   int *iwork = new int [liwork];
+
+   dsyevd_(&jobz,&uplo,&n,vec,&n,eigenvalues,work,&lwork,iwork,&liwork,&info);
+
+   delete [] work;
+   delete [] iwork;
+
+   if(info != 0){
+
+      std::cerr << "Matrix: dsyevd failed with info = " << info << " for a block of dimension " << n << endl;
+      exit(1);
+
+   }
+
+   //scale the eigenvectors with the square root of the absolute value of the eigenvalues
+   int neg = 0;
+
+   while(neg < n && eigenvalues[neg] < 0.0)
+      ++neg;
+
+   for(int i = 0;i < n;++i){
+
+      double scal = std::sqrt(std::fabs(eigenvalues[i]));
+
+      for(int j = 0;j < n;++j)
+         vec[i*n + j] *= scal;
+
+   }
+
+   delete [] eigenvalues;
+
+   if(m_f != 0){
+
+      if(scale <= 0.0 && neg <= m_f->gr_max()){
+
+         double *F = m_f->set_rank(neg);
+
+         double scal = std::sqrt(-scale);
+
+         for(int i = 0;i < neg*n;++i)
+            F[i] = scal * vec[i];
+
+      }
+      else
+         m_f->set_rank(-1);
+
+   }
+
+   syrk_tiled(neg,-scale,vec,m);
+
+   syrk_tiled(n - neg,1.0,vec + neg*n,p);
+
+   delete hulp;
+
+}
+
+/**
+ * C = alpha F F^T for an n x k matrix F (column major, leading dimension n = C.gn()). The upper triangle of C is divided in square tiles,
+ * every tile is a task: a dsyrk on the diagonal and a dgemm off the diagonal. Then C is symmetrized.
+ * @param k number of columns of F, C = 0 if k = 0
+ * @param alpha the factor
+ * @param F the n x k matrix
+ * @param C output: alpha F F^T
+ */
+void Matrix::syrk_tiled(int k,double alpha,double *F,Matrix &C){
+
+   if(k == 0){
+
+      C = 0.0;
+
+      return;
+
+   }
+
+   int n = C.n;
+
+   const int tile = 128;
+
+   int nt = (n + tile - 1)/tile;
+
+   //the tiles (I,J) with I <= J are numbered column by column, they are done one after the other by a multithreaded BLAS, see ThreadBudget
+   #pragma omp taskloop shared(C) grainsize(1) if(ThreadBudget::global_threads() == 1)
+   for(int t = 0;t < nt*(nt + 1)/2;++t){
+
+      int J = 0;
+
+      while((J + 1)*(J + 2)/2 <= t)
+         ++J;
+
+      int I = t - J*(J + 1)/2;
+
+      int i0 = I*tile;
+      int j0 = J*tile;
+
+      int bi = std::min(tile,n - i0);
+      int bj = std::min(tile,n - j0);
+
+      char uplo = 'U';
+      char trans = 'N';
+      char transb = 'T';
+
+      double a = alpha;
+      double beta = 0.0;
+
+      int lda = n;
+      int rank = k;
+
+      if(I == J)
+         dsyrk_(&uplo,&trans,&bi,&rank,&a,F + i0,&lda,&beta,C.matrix[0] + j0*n + i0,&lda);
+      else
+         dgemm_(&trans,&transb,&bi,&bj,&rank,&a,F + i0,&lda,F + j0,&lda,&beta,C.matrix[0] + j0*n + i0,&lda);
+
+   }
+
+   C.symmetrize();
+
+}
+
+/**
+ * Eigensolver free version of sep_pm: the sign function of the matrix is calculated with the scaled Newton-Schulz iteration
+ * (Chen and Chow) that only needs matrix-matrix products:\n\n
+ * X_k+1 = 1/2 mu_k X_k (3 - mu_k^2 X_k^2)\n\n
+ * starting from the matrix scaled to spectral radius smaller than one. The scaling factors mu_k are chosen to map the interval [l_k,1] optimally,
+ * with l_0 small enough that the eigenvalues that are left out only give a negligible contribution to the plus and minus part.
+ * Then p = (W + sign(W) W)/2 and m = W - p. (*this) is left unchanged. The iteration is always done in double precision.
+ * The storage of p and m is swapped every iteration, with their out-of-core and NUMA state, and swapped back at the end.
+ * @param p positive (plus) output part
+ * @param m negative (minus) output part
+ * @param scale the minus part is returned multiplied with scale
+ */
+void Matrix::sep_pm_sign(Matrix &p,Matrix &m,double scale){
+
+   //upper bound for the spectral radius: the smallest of the 1-norm and the Frobenius norm
+   double norm = 0.0;
+
+   for(int i = 0;i < n;++i){
+
+      double ward = 0.0;
+
+      for(int j = 0;j < n;++j)
+         ward += std::fabs(matrix[i][j]);
+
+      if(ward > norm)
+         norm = ward;
+
+   }
+
+   double norm_F = std::sqrt(this->ddot(*this));
+
+   if(norm_F < norm)
+      norm = norm_F;
+
+   if(norm == 0.0){
+
+      p = 0;
+      m = 0;
+
+      return;
+
+   }
+
+   //the iterate X is stored in p, m is used as workspace
+   p = *this;
+   p.dscal(1.0/norm);
+
+   Matrix X2(n,true);
+
+   X2.bind(node);
+
+   char uplo = 'U';
+   char trans = 'N';
+   char side = 'L';
+
+   double alpha,beta = 0.0;
+
+   double l = 1.0e-10;
+
+   bool swapped = false;
+
+   for(int iter = 0;iter < 100;++iter){
+
+      double mu = std::sqrt(3.0/(1.0 + l + l*l));
+
+      //X2 = 3 - mu^2 X^2
+      alpha = -mu*mu;
+
+      dsyrk_(&uplo,&trans,&n,&n,&alpha,p.matrix[0],&n,&beta,X2.matrix[0],&n);
+
+      X2.symmetrize();
+
+      for(int i = 0;i < n;++i)
+         X2.matrix[i][i] += 3.0;
+
+      //new iterate
+      alpha = 0.5*mu;
+
+      dsymm_(&side,&uplo,&n,&n,&alpha,p.matrix[0],&n,X2.matrix[0],&n,&beta,m.matrix[0],&n);
+
+      m.symmetrize();
+
+      //check the change in the iterate and make the new iterate current
+      p -= m;
+
+      double change = std::sqrt(p.ddot(p));
+
+      p.swap(m);
+
+      swapped = !swapped;
+
+      l = 0.5*mu*l*(3.0 - mu*mu*l*l);
+
+      if(change < 1.0e-10)
+         break;
+
+   }
+
+   //give p and m their own storage back, m may be (*this) of the caller, see sep_pm
+   if(swapped){
+
+      p.swap(m);
+
+      p = m;
+
+   }
+
+   //m = sign(W) W
+   alpha = 1.0;
+
+   dsymm_(&side,&uplo,&n,&n,&alpha,p.matrix[0],&n,matrix[0],&n,&beta,m.matrix[0],&n);
+
+   for(int i = 0;i < n;++i)
+      for(int j = i;j < n;++j){
+
+         double plus = 0.5*matrix[j][i] + 0.25*(m.matrix[j][i] + m.matrix[i][j]);
+
+         p.matrix[j][i] = p.matrix[i][j] = plus;
+         m.matrix[j][i] = m.matrix[i][j] = scale * (matrix[j][i] - plus);
+
+      }
+
+}
+
+/**
+ * Set the dimension from which on blocks are projected with the Newton-Schulz sign iteration in sep_pm instead of with lapack
+ * @param dim the threshold dimension, 0 means all blocks use lapack
+ */
+void Matrix::set_sign_dim(int dim){
+
+   sign_dim = dim;
+
+}
+
+/**
+ * Set the dimension from which on blocks are diagonalized with the parallel sep_pm_tiled in sep_pm instead of with dsyev
+ * @param dim the threshold dimension, 0 means never
+ */
+void Matrix::set_eig_dim(int dim){
+
+   eig_dim = dim;
+
+}
+
+/**
+ * Back all matrices with dimension larger than or equal to dim that are constructed from now on with files in the directory dir,
+ * see allocate. This bounds the resident memory: the largest blocks are paged in and out by the kernel.
+ * @param dim the dimension from which on matrices are stored out-of-core, 0 means never
+ * @param dir the directory for the files, preferably on a fast local disk
+ */
+void Matrix::set_mmap(int dim,const char *dir){
+
+   mmap_dim = dim;
+   mmap_dir = dir;
+
+}
+
+/**
+ * Hint to the kernel that the matrix will be used soon, so that an out-of-core matrix is read in asynchronously. Does nothing for a matrix in memory.
+ */
+void Matrix::prefetch() const{
+
+   if(mapped)
+      madvise(matrix[0],(size_t)n*n*sizeof(double),MADV_WILLNEED);
+
+}
+
+/**
+ * Hint to the kernel that the matrix will not be used for a while, so that the pages of an out-of-core matrix are dropped from the resident
+ * memory. The content is kept in the file. Does nothing for a matrix in memory.
+ */
+void Matrix::release() const{
+
+   if(mapped)
+      madvise(matrix[0],(size_t)n*n*sizeof(double),MADV_DONTNEED);
+
+}
+
+/**
+ * Bind the memory of the matrix to a NUMA node: the pages that are already touched are moved, see Numa::bind
+ * @param node the node, -2 to interleave the pages over all nodes
+ */
+void Matrix::bind(int node){
+
+   this->node = node;
+
+   Numa::bind(matrix[0],(size_t)n*n*sizeof(double),node);
+
+}
+
+/**
+ * @return the NUMA node to which the matrix is bound, -1 if it is not bound and -2 if it is interleaved
+ */
+int Matrix::gnode() const{
+
+   return node;
+
+}
+
+/**
+ * Mark the matrix as a block that is stored on another MPI rank (see Distribution): the memory is replaced by a read-only anonymous
+ * mapping, which reads as zero and takes no physical memory. The down maps read it as zero, assignments and symmetrize ignore it,
+ * and the up maps, sep_pm and the primal update skip it. Any other write to it is a bug and crashes.
+ */
+void Matrix::set_remote(){
+
+   if(remote || n == 0)
+      return;
+
+   deallocate(matrix[0],n,mapped);
+
+   void *ptr = mmap(0,(size_t)n*n*sizeof(double),PROT_READ,MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,-1,0);
+
+   if(ptr == MAP_FAILED){
+
+      std::cerr << "Matrix: mmap of a remote block of dimension " << n << " failed" << endl;
+      exit(1);
+
+   }
+
+   matrix[0] = (double *) ptr;
+
+   for(int i = 1;i < n;++i)
+      matrix[i] = matrix[i - 1] + n;
+
+   mapped = true;
+   remote = true;
+
+}
+
+/**
+ * @return true if the matrix is a block of another MPI rank, see set_remote
+ */
+bool Matrix::gremote() const{
+
+   return remote;
+
 }
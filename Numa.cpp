@@ -0,0 +1,550 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::endl;
+using std::ostream;
+using std::ifstream;
+using std::vector;
+
+#include "include.h"
+
+int Numa::n_nodes = 0;
+
+vector<int> Numa::placed;
+
+std::atomic<long> Numa::n_local(0);
+std::atomic<long> Numa::n_remote(0);
+
+namespace{
+
+   //memory policies and flags of the mbind system call, see linux/mempolicy.h
+   const int mpol_preferred = 1;
+   const int mpol_interleave = 3;
+   const unsigned mpol_mf_move = 1 << 1;
+
+   //the names of the parts of a SUP, in the order of SepStats
+   const char *part_name[] = {"P","Q","G","T1","T2"};
+
+   /**
+    * collect the BlockMatrix parts of a SUP, 0 for the conditions that are not active
+    * @param S the SUP
+    * @param parts output: array of SepStats::n_part pointers
+    */
+   void get_parts(const SUP &S,const BlockMatrix **parts){
+
+      for(int k = 0;k < SepStats::n_part;++k)
+         parts[k] = 0;
+
+      for(int i = 0;i < 2;++i)
+         parts[i] = &S.tpm(i);
+
+#ifdef __G_CON
+
+      parts[2] = &S.phm();
+
+#endif
+
+#ifdef __T1_CON
+
+      parts[3] = &S.dpm();
+
+#endif
+
+#ifdef __T2_CON
+
+      parts[4] = &S.pphm();
+
+#endif
+
+   }
+
+   /**
+    * collect the LRBlockMatrix parts of an LRSUP, 0 for the conditions that are not active
+    * @param X the LRSUP
+    * @param parts output: array of SepStats::n_part pointers
+    */
+   void get_parts(const LRSUP &X,const LRBlockMatrix **parts){
+
+      for(int k = 0;k < SepStats::n_part;++k)
+         parts[k] = 0;
+
+      for(int i = 0;i < 2;++i)
+         parts[i] = &X.tp(i);
+
+#ifdef __G_CON
+
+      parts[2] = &X.ph();
+
+#endif
+
+#ifdef __T1_CON
+
+      parts[3] = &X.dp();
+
+#endif
+
+#ifdef __T2_CON
+
+      parts[4] = &X.pph();
+
+#endif
+
+   }
+
+}
+
+/**
+ * @return the number of NUMA nodes of the machine, from /sys/devices/system/node/online (1 if it can't be read)
+ */
+int Numa::nodes(){
+
+   if(n_nodes > 0)
+      return n_nodes;
+
+   n_nodes = 1;
+
+   ifstream input("/sys/devices/system/node/online");
+
+   std::string online;
+
+   if(input >> online){
+
+      //a list of ranges like 0-1 or 0,2-3: the last number is the highest node
+      std::size_t pos = online.find_last_of(",-");
+
+      int last = atoi(online.c_str() + (pos == std::string::npos ? 0 : pos + 1));
+
+      if(last + 1 > n_nodes)
+         n_nodes = last + 1;
+
+   }
+
+   return n_nodes;
+
+}
+
+/**
+ * Set the memory policy of a range of memory and move the pages that are already touched. Only the whole pages in the range are
+ * bound, a matrix smaller than a page stays where it is. A node is preferred, not enforced, so that an allocation never fails
+ * because one node is full.
+ * @param ptr start of the memory
+ * @param bytes size of the memory
+ * @param node the node, -2 to interleave over all nodes, -1 to do nothing
+ */
+void Numa::bind(void *ptr,size_t bytes,int node){
+
+   if(node == -1 || nodes() < 2 || nodes() > (int)(8*sizeof(unsigned long)))
+      return;
+
+   size_t page = sysconf(_SC_PAGESIZE);
+
+   size_t start = ((size_t)ptr + page - 1)/page*page;
+   size_t end = ((size_t)ptr + bytes)/page*page;
+
+   if(end <= start)
+      return;
+
+   unsigned long mask;
+   int mode;
+
+   if(node == -2){
+
+      mask = (nodes() == 8*sizeof(unsigned long)) ? ~0UL : (1UL << nodes()) - 1;
+      mode = mpol_interleave;
+
+   }
+   else{
+
+      mask = 1UL << node;
+      mode = mpol_preferred;
+
+   }
+
+   //a failure only costs bandwidth: report() shows where the pages really are
+   syscall(SYS_mbind,(void *)start,end - start,mode,&mask,8*sizeof(unsigned long),mpol_mf_move);
+
+}
+
+/**
+ * Distribute the blocks of the dual SUP Z and of W over the NUMA nodes, block i of Z goes to the same node as block i of W.
+ * ThreadBudget::plan has to be called first.
+ * @param Z the dual SUP
+ * @param W the SUP that is projected and separated
+ */
+void Numa::place(SUP &Z,SUP &W){
+
+   if(nodes() < 2)
+      return;
+
+   const BlockMatrix *parts_Z[SepStats::n_part];
+   const BlockMatrix *parts_W[SepStats::n_part];
+
+   get_parts(Z,parts_Z);
+   get_parts(W,parts_W);
+
+   //all the blocks, largest first
+   vector< std::pair<int,Matrix *> > blocks_Z,blocks_W;
+
+   for(int k = 0;k < SepStats::n_part;++k)
+      if(parts_W[k] != 0)
+         for(int i = 0;i < parts_W[k]->gnr();++i){
+
+            blocks_Z.push_back(std::make_pair(parts_W[k]->gdim(i),const_cast<Matrix *>(&(*parts_Z[k])[i])));
+            blocks_W.push_back(std::make_pair(parts_W[k]->gdim(i),const_cast<Matrix *>(&(*parts_W[k])[i])));
+
+         }
+
+   vector<int> order(blocks_W.size());
+
+   for(unsigned int b = 0;b < order.size();++b)
+      order[b] = b;
+
+   std::stable_sort(order.begin(),order.end(),[&blocks_W](int a,int b){ return blocks_W[a].first > blocks_W[b].first; });
+
+   int per_node = ThreadBudget::gthreads()/nodes();
+
+   if(per_node < 1)
+      per_node = 1;
+
+   vector<double> load(nodes(),0.0);
+
+   placed.assign(blocks_W.size(),-1);
+
+   for(unsigned int b = 0;b < order.size();++b){
+
+      int n = blocks_W[order[b]].first;
+
+      int node = -2;
+
+      if(ThreadBudget::blas_threads(n) <= per_node){
+
+         node = std::min_element(load.begin(),load.end()) - load.begin();
+
+         load[node] += (double)n*n*n;
+
+      }
+
+      blocks_W[order[b]].second->bind(node);
+      blocks_Z[order[b]].second->bind(node);
+
+      placed[order[b]] = node;
+
+   }
+
+}
+
+/**
+ * count on which node the pages of a matrix are
+ * @param A the matrix
+ * @param count output: count[k] is the number of pages on node k, count[nodes()] the number of pages that are not in memory
+ */
+void Numa::pages(const Matrix &A,long *count){
+
+   for(int k = 0;k <= nodes();++k)
+      count[k] = 0;
+
+   size_t page = sysconf(_SC_PAGESIZE);
+
+   size_t start = (size_t)A.matrix[0]/page*page;
+   size_t end = (size_t)(A.matrix[0] + (size_t)A.gn()*A.gn());
+
+   long n_pages = (end - start + page - 1)/page;
+
+   vector<void *> addr(n_pages);
+   vector<int> status(n_pages,-1);
+
+   for(long p = 0;p < n_pages;++p)
+      addr[p] = (void *)(start + p*page);
+
+   //without target nodes move_pages only returns the node of every page
+   if(syscall(SYS_move_pages,0,n_pages,addr.data(),(void *)0,status.data(),0) != 0){
+
+      count[nodes()] = n_pages;
+      return;
+
+   }
+
+   for(long p = 0;p < n_pages;++p){
+
+      if(status[p] >= 0 && status[p] < nodes())
+         ++count[status[p]];
+      else
+         ++count[nodes()];
+
+   }
+
+}
+
+/**
+ * Print for every block of a SUP the node it was bound to and the fraction of its pages that are on every node
+ * @param output The stream to which you are writing (e.g. cout)
+ * @param S the SUP
+ */
+void Numa::report(ostream &output,const SUP &S){
+
+   const BlockMatrix *parts[SepStats::n_part];
+
+   get_parts(S,parts);
+
+   long *count = new long [nodes() + 1];
+
+   output << "part\tblock\tdim\tbound\tpages per node";
+
+   for(int k = 0;k < nodes();++k)
+      output << "\t" << k;
+
+   output << "\tnot present" << endl;
+
+   for(int k = 0;k < SepStats::n_part;++k){
+
+      if(parts[k] == 0)
+         continue;
+
+      for(int i = 0;i < parts[k]->gnr();++i){
+
+         const Matrix &A = (*parts[k])[i];
+
+         output << part_name[k] << "\t" << i << "\t" << A.gn() << "\t";
+
+         if(A.gnode() == -2)
+            output << "interleaved";
+         else if(A.gnode() == -1)
+            output << "no";
+         else
+            output << A.gnode();
+
+         pages(A,count);
+
+         long total = 0;
+
+         for(int n = 0;n <= nodes();++n)
+            total += count[n];
+
+         output << "\t";
+
+         for(int n = 0;n <= nodes();++n)
+            output << "\t" << 100.0*count[n]/total << "%";
+
+         output << endl;
+
+      }
+
+   }
+
+   delete [] count;
+
+}
+
+/**
+ * Check that the blocks of Z and W are still bound to the node that place() chose for them, and the dense blocks of X to the node of
+ * their block of W. Print the blocks that are not, and a summary.
+ * @param output The stream to which you are writing (e.g. cout)
+ * @param Z the dual SUP
+ * @param W the SUP that is projected and separated
+ * @param X the primal matrix
+ * @return the number of blocks that are no longer on their node
+ */
+int Numa::check(ostream &output,const SUP &Z,const SUP &W,const LRSUP &X){
+
+   if(placed.empty()){
+
+      output << "NUMA check: no blocks were placed" << endl;
+
+      return 0;
+
+   }
+
+   const BlockMatrix *parts_Z[SepStats::n_part];
+   const BlockMatrix *parts_W[SepStats::n_part];
+   const LRBlockMatrix *parts_X[SepStats::n_part];
+
+   get_parts(Z,parts_Z);
+   get_parts(W,parts_W);
+   get_parts(X,parts_X);
+
+   int moved = 0;
+   int b = 0;
+
+   for(int k = 0;k < SepStats::n_part;++k)
+      if(parts_W[k] != 0)
+         for(int i = 0;i < parts_W[k]->gnr();++i){
+
+            int node[3] = {(*parts_Z[k])[i].gnode(),(*parts_W[k])[i].gnode(),(*parts_X[k])[i].gnode()};
+
+            const char *name[3] = {"Z","W","X"};
+
+            for(int s = 0;s < 3;++s){
+
+               //a factored or empty block of X has no node
+               if(s == 2 && ((*parts_X[k])[i].factored() || (*parts_X[k])[i].memory() == 0))
+                  continue;
+
+               if(node[s] != placed[b]){
+
+                  output << "NUMA check: block " << i << " of " << part_name[k] << " of " << name[s] << " is on node " << node[s]
+                     << ", it was placed on " << placed[b] << endl;
+
+                  ++moved;
+
+               }
+
+            }
+
+            ++b;
+
+         }
+
+   if(moved == 0)
+      output << "NUMA check: all blocks of Z, W and X are on the node they were placed on" << endl;
+
+   long total = n_local + n_remote;
+
+   if(total > 0)
+      output << "NUMA check: " << 100.0*n_local/total << "% of the " << total << " block tasks ran on the node of their block" << endl;
+
+   return moved;
+
+}
+
+/**
+ * Execute work(i) for i = 0,...,count - 1 in tasks and wait for them. Without placement (see place) this is a plain taskloop. Otherwise
+ * every node gets a queue of the tasks of its blocks, and as many worker tasks as there are threads are created: a worker first executes the
+ * tasks of the node of the thread it runs on, then the tasks without a node (interleaved blocks) and only then those of the other nodes,
+ * when the threads of these are busy with other work. The tasks of a queue are started in their order, so the long ones go first.
+ * Every task is executed once, so the result doesn't depend on the thread that executes it.
+ * @param count the number of tasks
+ * @param node node[i] is the node of the block that task i works on, -1 or -2 if it has none
+ * @param work the task
+ */
+void Numa::run(int count,const int *node,const std::function<void(int)> &work){
+
+   if(placed.empty()){
+
+      #pragma omp taskloop shared(work) grainsize(1)
+      for(int i = 0;i < count;++i)
+         work(i);
+
+      return;
+
+   }
+
+   int n = nodes();
+
+   //the last queue holds the tasks without a node
+   vector< vector<int> > queue(n + 1);
+
+   for(int i = 0;i < count;++i)
+      queue[(node[i] >= 0 && node[i] < n) ? node[i] : n].push_back(i);
+
+   std::unique_ptr<std::atomic<int>[]> next(new std::atomic<int>[n + 1]);
+
+   for(int k = 0;k <= n;++k)
+      next[k] = 0;
+
+   int workers = std::min(count,ThreadBudget::gthreads());
+
+   #pragma omp taskgroup
+   {
+
+      for(int w = 0;w < workers;++w){
+
+         #pragma omp task shared(queue,next,work,n)
+         {
+
+            int home = current();
+
+            for(int k = 0;k <= n;++k){
+
+               //the own node, the tasks without a node, the other nodes
+               int q = (k == 0) ? home : ((k == 1) ? n : (home + k - 1) % n);
+
+               for(int i = next[q]++;i < (int)queue[q].size();i = next[q]++){
+
+                  work(queue[q][i]);
+
+                  if(q == home)
+                     ++n_local;
+                  else if(q < n)
+                     ++n_remote;
+
+               }
+
+            }
+
+         }
+
+      }
+
+   }
+
+}
+
+/**
+ * Execute the tasks of a block in tasks on its node, see run(count,node,work)
+ * @param count the number of tasks
+ * @param node the node of the block, -1 or -2 if it has none
+ * @param work the task
+ */
+void Numa::run(int count,int node,const std::function<void(int)> &work){
+
+   vector<int> same(count,node);
+
+   run(count,same.data(),work);
+
+}
+
+/**
+ * @return the node of the cpu the calling thread runs on, 0 if it can't be determined
+ */
+int Numa::current(){
+
+   unsigned int cpu = 0,node = 0;
+
+   if(syscall(SYS_getcpu,&cpu,&node,(void *)0) != 0 || (int)node >= nodes())
+      return 0;
+
+   return node;
+
+}
+
+/**
+ * Print on which cpu and node every thread of a parallel region like the one of the solver runs
+ * @param output The stream to which you are writing (e.g. cout)
+ */
+void Numa::report_threads(ostream &output){
+
+   int threads = ThreadBudget::gthreads();
+
+   vector<unsigned int> cpu(threads,0),node(threads,0);
+
+   #pragma omp parallel proc_bind(spread)
+   {
+
+#ifdef _OPENMP
+      int t = omp_get_thread_num();
+#else
+      int t = 0;
+#endif
+
+      if(t < threads)
+         syscall(SYS_getcpu,&cpu[t],&node[t],(void *)0);
+
+   }
+
+   for(int t = 0;t < threads;++t)
+      output << "thread " << t << ": cpu " << cpu[t] << ", node " << node[t] << endl;
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
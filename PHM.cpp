@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <utility>
 #include <cstdlib>
 #include <cmath>
 
@@ -29,13 +30,18 @@ PHM::PHM(int M,int N) : BlockMatrix(2) {
    this->M = M;
 
    //set the dimension of the blocks
-   this->setMatrixDim(0,M*M/4,1);
-   this->setMatrixDim(1,M*M/4,3);
+   this->setMatrixDim(0,block_dim(M,0),1);
+   this->setMatrixDim(1,block_dim(M,1),3);
 
-   if(counter == 0)
-      constr_lists();
+   #pragma omp critical(phm_lists)
+   {
 
-   ++counter;
+      if(counter == 0)
+         constr_lists();
+
+      ++counter;
+
+   }
 
 }
 
@@ -49,10 +55,36 @@ PHM::PHM(const PHM &phm_c) : BlockMatrix(phm_c){
    this->N = phm_c.gN();
    this->M = phm_c.gM();
 
-   if(counter == 0)
-      constr_lists();
+   #pragma omp critical(phm_lists)
+   {
+
+      if(counter == 0)
+         constr_lists();
+
+      ++counter;
+
+   }
+
+}
 
-   ++counter;
+/**
+ * move constructor: takes over the blocks of phm_m without copying, see BlockMatrix(BlockMatrix &&)
+ * @param phm_m object that will be moved into this.
+ */
+PHM::PHM(PHM &&phm_m) : BlockMatrix(std::move(phm_m)){
+
+   this->N = phm_m.gN();
+   this->M = phm_m.gM();
+
+   #pragma omp critical(phm_lists)
+   {
+
+      if(counter == 0)
+         constr_lists();
+
+      ++counter;
+
+   }
 
 }
 
@@ -61,24 +93,41 @@ PHM::PHM(const PHM &phm_c) : BlockMatrix(phm_c){
  */
 PHM::~PHM(){
 
-   if(counter == 1){
+   #pragma omp critical(phm_lists)
+   {
 
-      delete [] s2ph[0];
-      delete [] s2ph;
+      if(counter == 1){
 
-      for(int i = 0;i < M*M/4;++i)
-         delete [] ph2s[i];
+         delete [] s2ph[0];
+         delete [] s2ph;
 
-      delete [] ph2s;
+         for(int i = 0;i < M*M/4;++i)
+            delete [] ph2s[i];
 
-      for(int S = 0;S < 2;++S)
-         delete [] _6j[S];
+         delete [] ph2s;
 
-      delete [] _6j;
+         for(int S = 0;S < 2;++S)
+            delete [] _6j[S];
+
+         delete [] _6j;
+
+      }
+
+      --counter;
 
    }
 
-   --counter;
+}
+
+/**
+ * move assignment: swaps the blocks of (*this) and phm_m, no numbers are copied
+ * @param phm_m object that will be moved into this.
+ */
+PHM &PHM::operator=(PHM &&phm_m){
+
+   this->swap(phm_m);
+
+   return *this;
 
 }
 
@@ -215,40 +264,89 @@ void PHM::G(const TPM &tpm){
    //construct the SPM corresponding to the TPM
    SPM spm(1.0/(N - 1.0),tpm);
 
-   int a,b,c,d;
+   this->G(spm,tpm);
+
+}
+
+/**
+ * The G map with the SPM of the input TPM already constructed, see SUP::fill.
+ * @param spm the SPM of tpm, scaled with 1/(N-1)
+ * @param tpm input TPM
+ */
+void PHM::G(const SPM &spm,const TPM &tpm){
+
+   //the kernel of every block is specialized on its spin
+   static void (PHM::*const kernel[2])(const SPM &,const TPM &) = {&PHM::G_block<0>,&PHM::G_block<1>};
+
+   //the vector kernels, 0 if the scalar kernels are used
+   const MapStreams *vec = MapStreams::get(M);
+
+   const double *tp[2] = {tpm[0].gMatrix()[0],tpm[1].gMatrix()[0]};
 
    for(int S = 0;S < 2;++S){
 
-      for(int i = 0;i < this->gdim(S);++i){
+      //the block of another MPI rank is not filled, see Distribution
+      if((*this)[S].gremote())
+         continue;
 
-         a = ph2s[i][0];
-         b = ph2s[i][1];
+      if(vec != 0)
+         vec->G(S,spm.gMatrix()[0],tp,(*this)[S].gMatrix()[0],(*this)[S].gnode());
+      else
+         (this->*kernel[S])(spm,tpm);
 
-         for(int j = i;j < this->gdim(S);++j){
+   }
 
-            c = ph2s[j][0];
-            d = ph2s[j][1];
+   this->symmetrize();
 
-            //tp part
-            (*this)(S,i,j) = -_6j[S][0]*tpm(0,a,d,c,b) - 3.0*_6j[S][1]*tpm(1,a,d,c,b);
+}
 
-            //norm
-            if(a == d)
-               (*this)(S,i,j) *= std::sqrt(2.0);
+/**
+ * The G map of PHM::G(spm,tpm) for the block with spin S, which is known at compile time.
+ * @param spm the SPM of tpm, scaled with 1/(N-1)
+ * @param tpm input TPM
+ */
+template<int S>
+void PHM::G_block(const SPM &spm,const TPM &tpm){
 
-            if(c == b)
-               (*this)(S,i,j) *= std::sqrt(2.0);
+   int n = this->gdim(S);
+   int m = spm.gn();
 
-            //sp part
-            if(b == d)
-               (*this)(S,i,j) += spm(a,c);
+   double *out = (*this)[S].gMatrix()[0];
 
-         }
-      }
+   const double *sp = spm.gMatrix()[0];
 
-   }
+   const double *tp[2] = {tpm[0].gMatrix()[0],tpm[1].gMatrix()[0]};
+   int n_tp[2] = {tpm.gdim(0),tpm.gdim(1)};
 
-   this->symmetrize();
+   //every row is a task on the node of the block, see Numa::run
+   Numa::run(n,(*this)[S].gnode(),[&](int i){
+
+      int a = ph2s[i][0];
+      int b = ph2s[i][1];
+
+      for(int j = i;j < n;++j){
+
+         int c = ph2s[j][0];
+         int d = ph2s[j][1];
+
+         //tp part
+         double ward = -Spin<S>::_6j[0]*TPM::sp<0>(tp[0],n_tp[0],a,d,c,b) - 3.0*Spin<S>::_6j[1]*TPM::sp<1>(tp[1],n_tp[1],a,d,c,b);
+
+         //norm
+         if(a == d)
+            ward *= std::sqrt(2.0);
+
+         if(c == b)
+            ward *= std::sqrt(2.0);
+
+         //sp part
+         if(b == d)
+            ward += sp[a + c*m];
+
+         out[i + j*n] = ward;
+
+      }
+   });
 
 }
 
@@ -258,21 +356,18 @@ void PHM::G(const TPM &tpm){
  */
 void PHM::bar(const PPHM &pphm){
 
-   int a,b,c,d;
-
-   double ward,hard;
-
    for(int S = 0;S < 2;++S){//loop over spinblocks of PHM
 
-      for(int i = 0;i < this->gdim(S);++i){
+      //most of the elements that are read are in the S = 1/2 block of the PPHM: every row is a task on its node, see Numa::run
+      Numa::run(this->gdim(S),pphm[0].gnode(),[&](int i){
 
-         a = ph2s[i][0];
-         b = ph2s[i][1];
+         int a = ph2s[i][0];
+         int b = ph2s[i][1];
 
          for(int j = i;j < this->gdim(S);++j){
 
-            c = ph2s[j][0];
-            d = ph2s[j][1];
+            int c = ph2s[j][0];
+            int d = ph2s[j][1];
 
             (*this)(S,i,j) = 0.0;
 
@@ -280,11 +375,11 @@ void PHM::bar(const PPHM &pphm){
             for(int S_ab = 0;S_ab < 2;++S_ab)
                for(int S_de = 0;S_de < 2;++S_de){
 
-                  ward = 2.0 * std::sqrt( (2.0*S_ab + 1.0) * (2.0*S_de + 1.0) ) * _6j[S][S_ab] * _6j[S][S_de];
+                  double ward = 2.0 * std::sqrt( (2.0*S_ab + 1.0) * (2.0*S_de + 1.0) ) * _6j[S][S_ab] * _6j[S][S_de];
 
                   for(int l = 0;l < M/2;++l){
 
-                     hard = ward * pphm(0,S_ab,l,a,b,S_de,l,c,d);
+                     double hard = ward * pphm(0,S_ab,l,a,b,S_de,l,c,d);
 
                      //norms
                      if(l == a)
@@ -305,7 +400,7 @@ void PHM::bar(const PPHM &pphm){
                   (*this)(S,i,j) += 4.0/3.0 * pphm(1,1,l,a,b,1,l,c,d);
 
          }
-      }
+      });
 
    }
 
@@ -406,3 +501,15 @@ void PHM::in_sp(const char *filename){
    this->symmetrize();
 
 }
+
+/**
+ * The dimensions of the blocks of a PHM, without constructing one (used to estimate the memory use of a run)
+ * @param M dimension of sp space
+ * @param i the block index: 0 or 1 for the S=0 and S=1 block
+ * @return the dimension of block i
+ */
+int PHM::block_dim(int M,int i){
+
+   return M*M/4;
+
+}
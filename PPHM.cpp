@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <utility>
 #include <cstdlib>
 #include <cmath>
 
@@ -29,13 +30,18 @@ PPHM::PPHM(int M,int N) : BlockMatrix(2) {
    this->M = M;
 
    //set the dimension and the degeneracies of the blocks
-   this->setMatrixDim(0,M*M*M/8,2);//S=1/2 block
-   this->setMatrixDim(1,M*M*(M - 2)/16,4);//S=3/2 block
+   this->setMatrixDim(0,block_dim(M,0),2);//S=1/2 block
+   this->setMatrixDim(1,block_dim(M,1),4);//S=3/2 block
 
-   if(counter == 0)//make the lists
-      construct_lists();
+   #pragma omp critical(pphm_lists)
+   {
 
-   ++counter;
+      if(counter == 0)//make the lists
+         construct_lists();
+
+      ++counter;
+
+   }
 
 }
 
@@ -49,10 +55,36 @@ PPHM::PPHM(const PPHM &pphm_c) : BlockMatrix(pphm_c) {
    this->N = pphm_c.gN();
    this->M = pphm_c.gM();
 
-   if(counter == 0)
-      construct_lists();
+   #pragma omp critical(pphm_lists)
+   {
+
+      if(counter == 0)
+         construct_lists();
+
+      ++counter;
+
+   }
+
+}
+
+/**
+ * move constructor: takes over the blocks of pphm_m without copying, see BlockMatrix(BlockMatrix &&)
+ * @param pphm_m object that will be moved into this.
+ */
+PPHM::PPHM(PPHM &&pphm_m) : BlockMatrix(std::move(pphm_m)){
+
+   this->N = pphm_m.gN();
+   this->M = pphm_m.gM();
+
+   #pragma omp critical(pphm_lists)
+   {
 
-   ++counter;
+      if(counter == 0)
+         construct_lists();
+
+      ++counter;
+
+   }
 
 }
 
@@ -61,61 +93,78 @@ PPHM::PPHM(const PPHM &pphm_c) : BlockMatrix(pphm_c) {
  */
 PPHM::~PPHM(){
 
-   if(counter == 1){
+   #pragma omp critical(pphm_lists)
+   {
 
-      //first delete S = 1/2 part
-      for(int S_ab = 0;S_ab < 2;++S_ab){
+      if(counter == 1){
 
-         for(int a = 0;a < M/2;++a){
+         //first delete S = 1/2 part
+         for(int S_ab = 0;S_ab < 2;++S_ab){
 
-            for(int b = 0;b < M/2;++b)
-               delete [] s2pph[0][S_ab][a][b];
+            for(int a = 0;a < M/2;++a){
+
+               for(int b = 0;b < M/2;++b)
+                  delete [] s2pph[0][S_ab][a][b];
+
+               delete [] s2pph[0][S_ab][a];
 
-            delete [] s2pph[0][S_ab][a];
+            }
+
+            delete [] s2pph[0][S_ab];
 
          }
 
-         delete [] s2pph[0][S_ab];
+         //then the S = 3/2 part
+         for(int a = 0;a < M/2;++a){
 
-      }
+            for(int b = 0;b < M/2;++b)
+               delete [] s2pph[1][0][a][b];
 
-      //then the S = 3/2 part
-      for(int a = 0;a < M/2;++a){
+            delete [] s2pph[1][0][a];
 
-         for(int b = 0;b < M/2;++b)
-            delete [] s2pph[1][0][a][b];
+         }
 
-         delete [] s2pph[1][0][a];
+         delete [] s2pph[1][0];
 
-      }
+         for(int S = 0;S < 2;++S)
+            delete [] s2pph[S];
 
-      delete [] s2pph[1][0];
+         delete [] s2pph;
 
-      for(int S = 0;S < 2;++S)
-         delete [] s2pph[S];
+         //now delete pph2s 
+         for(int S = 0;S < 2;++S){
 
-      delete [] s2pph;
+            for(int i = 0;i < this->gdim(S);++i)
+               delete [] pph2s[S][i];
 
-      //now delete pph2s 
-      for(int S = 0;S < 2;++S){
+            delete [] pph2s[S];
 
-         for(int i = 0;i < this->gdim(S);++i)
-            delete [] pph2s[S][i];
+         }
 
-         delete [] pph2s[S];
+         delete [] pph2s;
 
-      }
+         for(int S = 0;S < 2;++S)
+            delete [] _6j[S];
 
-      delete [] pph2s;
+         delete [] _6j;
 
-      for(int S = 0;S < 2;++S)
-         delete [] _6j[S];
+      }
 
-      delete [] _6j;
+      --counter;
 
    }
 
-   --counter;
+}
+
+/**
+ * move assignment: swaps the blocks of (*this) and pphm_m, no numbers are copied
+ * @param pphm_m object that will be moved into this.
+ */
+PPHM &PPHM::operator=(PPHM &&pphm_m){
+
+   this->swap(pphm_m);
+
+   return *this;
 
 }
 
@@ -368,13 +417,42 @@ void PPHM::T(const TPM &tpm){
 
    SPM spm(1.0/(N - 1.0),tpm);
 
-   int a,b,c,d,e,z;
-   int S_ab,S_de;
+   this->T(spm,tpm);
+
+}
+
+/**
+ * The spincoupled T2 map with the SPM of the input TPM already constructed, see SUP::fill.
+ * @param spm the SPM of tpm, scaled with 1/(N-1)
+ * @param tpm Input TPM matrix
+ */
+void PPHM::T(const SPM &spm,const TPM &tpm){
+
+   //the blocks of other MPI ranks are not filled, see Distribution
+   int rows[2];
+
+   for(int S = 0;S < 2;++S)
+      rows[S] = (*this)[S].gremote() ? 0 : this->gdim(S);
+
+   //the elements of the blocks are indexed directly, the tp elements with the spin known at compile time (see TPM::sp)
+   int n[2] = {this->gdim(0),this->gdim(1)};
+
+   double *out[2] = {(*this)[0].gMatrix()[0],(*this)[1].gMatrix()[0]};
+
+   int m = spm.gn();
+   const double *sp = spm.gMatrix()[0];
 
-   double norm_ab,norm_de;
-   int sign_ab,sign_de;
+   const double *tp[2] = {tpm[0].gMatrix()[0],tpm[1].gMatrix()[0]};
+   int n_tp[2] = {tpm.gdim(0),tpm.gdim(1)};
 
-   for(int i = 0;i < this->gdim(0);++i){
+   //every row is a task on the node of its block, see Numa::run
+   Numa::run(rows[0],(*this)[0].gnode(),[&](int i){
+
+      int a,b,c,d,e,z;
+      int S_ab,S_de;
+
+      double norm_ab,norm_de;
+      int sign_ab,sign_de;
 
       S_ab = pph2s[0][i][0];
 
@@ -389,7 +467,7 @@ void PPHM::T(const TPM &tpm){
       if(a == b)
          norm_ab /= std::sqrt(2.0);
 
-      for(int j = i;j < this->gdim(0);++j){
+      for(int j = i;j < n[0];++j){
 
          S_de = pph2s[0][j][0];
 
@@ -406,26 +484,28 @@ void PPHM::T(const TPM &tpm){
 
 
          //start the map:
-         (*this)(0,i,j) = 0.0;
+         double hard = 0.0;
 
          //tp(1)
          if(c == z)
             if(S_ab == S_de)
-               (*this)(0,i,j) += tpm(S_ab,a,b,d,e);
+               hard += (S_ab == 0) ? TPM::sp<0>(tp[0],n_tp[0],a,b,d,e) : TPM::sp<1>(tp[1],n_tp[1],a,b,d,e);
 
          if(a == d){
 
             //sp(1) first term
             if(b == e)
                if(S_ab == S_de)
-                  (*this)(0,i,j) += norm_ab * norm_de * spm(c,z);
+                  hard += norm_ab * norm_de * sp[c + z*m];
 
             //tp(2)
+            double t[2] = {TPM::sp<0>(tp[0],n_tp[0],c,e,z,b),TPM::sp<1>(tp[1],n_tp[1],c,e,z,b)};
+
             double ward = 0.0;
 
             for(int J = 0;J < 2;++J)
                for(int Z = 0;Z < 2;++Z)
-                  ward += (2*J + 1.0) * (2*Z + 1.0) * _6j[J][S_ab] * _6j[J][S_de] * _6j[J][Z] * tpm(Z,c,e,z,b);
+                  ward += (2*J + 1.0) * (2*Z + 1.0) * _6j[J][S_ab] * _6j[J][S_de] * _6j[J][Z] * t[Z];
 
             ward *= norm_ab * norm_de * std::sqrt( (2.0*S_ab + 1.0) * (2.0*S_de + 1.0) );
 
@@ -435,7 +515,7 @@ void PPHM::T(const TPM &tpm){
             if(z == b)
                ward *= std::sqrt(2.0);
 
-            (*this)(0,i,j) -= ward;
+            hard -= ward;
 
          }
 
@@ -444,14 +524,16 @@ void PPHM::T(const TPM &tpm){
             //sp(1) second term
             if(a == e)
                if(S_ab == S_de)
-                  (*this)(0,i,j) += sign_ab * norm_ab * norm_de * spm(c,z);
+                  hard += sign_ab * norm_ab * norm_de * sp[c + z*m];
 
             //tp(3)
+            double t[2] = {TPM::sp<0>(tp[0],n_tp[0],c,e,z,a),TPM::sp<1>(tp[1],n_tp[1],c,e,z,a)};
+
             double ward = 0.0;
 
             for(int J = 0;J < 2;++J)
                for(int Z = 0;Z < 2;++Z)
-                  ward += (2*J + 1.0) * (2*Z + 1.0) * _6j[J][S_ab] * _6j[J][S_de] * _6j[J][Z] * tpm(Z,c,e,z,a);
+                  ward += (2*J + 1.0) * (2*Z + 1.0) * _6j[J][S_ab] * _6j[J][S_de] * _6j[J][Z] * t[Z];
 
             ward *= norm_ab * norm_de * std::sqrt( (2.0*S_ab + 1.0) * (2.0*S_de + 1.0) );
 
@@ -461,18 +543,20 @@ void PPHM::T(const TPM &tpm){
             if(z == a)
                ward *= std::sqrt(2.0);
 
-            (*this)(0,i,j) -= sign_ab * ward;
+            hard -= sign_ab * ward;
 
          }
 
          //tp(4)
          if(a == e){
 
+            double t[2] = {TPM::sp<0>(tp[0],n_tp[0],c,d,z,b),TPM::sp<1>(tp[1],n_tp[1],c,d,z,b)};
+
             double ward = 0.0;
 
             for(int J = 0;J < 2;++J)
                for(int Z = 0;Z < 2;++Z)
-                  ward += (2*J + 1.0) * (2*Z + 1.0) * _6j[J][S_ab] * _6j[J][S_de] * _6j[J][Z] * tpm(Z,c,d,z,b);
+                  ward += (2*J + 1.0) * (2*Z + 1.0) * _6j[J][S_ab] * _6j[J][S_de] * _6j[J][Z] * t[Z];
 
             ward *= norm_ab * norm_de * std::sqrt( (2.0*S_ab + 1.0) * (2.0*S_de + 1.0) );
 
@@ -482,18 +566,20 @@ void PPHM::T(const TPM &tpm){
             if(z == b)
                ward *= std::sqrt(2.0);
 
-            (*this)(0,i,j) -= sign_de * ward;
+            hard -= sign_de * ward;
 
          }
 
          //tp(5)
          if(b == e){
 
+            double t[2] = {TPM::sp<0>(tp[0],n_tp[0],c,d,z,a),TPM::sp<1>(tp[1],n_tp[1],c,d,z,a)};
+
             double ward = 0.0;
 
             for(int J = 0;J < 2;++J)
                for(int Z = 0;Z < 2;++Z)
-                  ward += (2*J + 1.0) * (2*Z + 1.0) * _6j[J][S_ab] * _6j[J][S_de] * _6j[J][Z] * tpm(Z,c,d,z,a);
+                  ward += (2*J + 1.0) * (2*Z + 1.0) * _6j[J][S_ab] * _6j[J][S_de] * _6j[J][Z] * t[Z];
 
             ward *= norm_ab * norm_de * std::sqrt( (2.0*S_ab + 1.0) * (2.0*S_de + 1.0) );
 
@@ -503,45 +589,49 @@ void PPHM::T(const TPM &tpm){
             if(z == a)
                ward *= std::sqrt(2.0);
 
-            (*this)(0,i,j) -= sign_ab * sign_de * ward;
+            hard -= sign_ab * sign_de * ward;
 
          }
 
+         out[0][i + j*n[0]] = hard;
+
       }
 
-   }
+   });
 
    //the easier S = 3/2 part:
-   for(int i = 0;i < this->gdim(1);++i){
+   Numa::run(rows[1],(*this)[1].gnode(),[&](int i){
+
+      int a,b,c,d,e,z;
 
       a = pph2s[1][i][1];
       b = pph2s[1][i][2];
       c = pph2s[1][i][3];
 
-      for(int j = i;j < this->gdim(1);++j){
+      for(int j = i;j < n[1];++j){
 
          d = pph2s[1][j][1];
          e = pph2s[1][j][2];
          z = pph2s[1][j][3];
 
          //init
-         (*this)(1,i,j) = 0.0;
+         double hard = 0.0;
 
          //tp(1)
          if(c == z)
-            (*this)(1,i,j) += tpm(1,a,b,d,e);
+            hard += TPM::sp<1>(tp[1],n_tp[1],a,b,d,e);
 
          if(a == d){
 
             //sp(1)
             if(b == e)
-               (*this)(1,i,j) += spm(c,z);
+               hard += sp[c + z*m];
 
             //tp(2)
             double ward = 0.0;
 
-            for(int Z = 0;Z < 2;++Z)
-               ward += (2*Z + 1.0) * _6j[1][Z] * tpm(Z,c,e,z,b);
+            ward += (2*0 + 1.0) * Spin<1>::_6j[0] * TPM::sp<0>(tp[0],n_tp[0],c,e,z,b);
+            ward += (2*1 + 1.0) * Spin<1>::_6j[1] * TPM::sp<1>(tp[1],n_tp[1],c,e,z,b);
 
             if(c == e)
                ward *= std::sqrt(2.0);
@@ -549,7 +639,7 @@ void PPHM::T(const TPM &tpm){
             if(z == b)
                ward *= std::sqrt(2.0);
 
-            (*this)(1,i,j) -= ward;
+            hard -= ward;
 
          }
 
@@ -558,8 +648,8 @@ void PPHM::T(const TPM &tpm){
 
             double ward = 0.0;
 
-            for(int Z = 0;Z < 2;++Z)
-               ward += (2*Z + 1.0) * _6j[1][Z] * tpm(Z,c,e,z,a);
+            ward += (2*0 + 1.0) * Spin<1>::_6j[0] * TPM::sp<0>(tp[0],n_tp[0],c,e,z,a);
+            ward += (2*1 + 1.0) * Spin<1>::_6j[1] * TPM::sp<1>(tp[1],n_tp[1],c,e,z,a);
 
             if(c == e)
                ward *= std::sqrt(2.0);
@@ -567,7 +657,7 @@ void PPHM::T(const TPM &tpm){
             if(z == a)
                ward *= std::sqrt(2.0);
 
-            (*this)(1,i,j) += ward;
+            hard += ward;
 
          }
 
@@ -576,8 +666,8 @@ void PPHM::T(const TPM &tpm){
 
             double ward = 0.0;
 
-            for(int Z = 0;Z < 2;++Z)
-               ward += (2*Z + 1.0) * _6j[1][Z] * tpm(Z,c,d,z,a);
+            ward += (2*0 + 1.0) * Spin<1>::_6j[0] * TPM::sp<0>(tp[0],n_tp[0],c,d,z,a);
+            ward += (2*1 + 1.0) * Spin<1>::_6j[1] * TPM::sp<1>(tp[1],n_tp[1],c,d,z,a);
 
             if(c == d)
                ward *= std::sqrt(2.0);
@@ -585,13 +675,15 @@ void PPHM::T(const TPM &tpm){
             if(z == a)
                ward *= std::sqrt(2.0);
 
-            (*this)(1,i,j) -= ward;
+            hard -= ward;
 
          }
 
+         out[1][i + j*n[1]] = hard;
+
       }
 
-   }
+   });
 
    this->symmetrize();
 
@@ -665,3 +757,18 @@ void PPHM::in_sp(const char *filename){
    this->symmetrize();
 
 }
+
+/**
+ * The dimensions of the blocks of a PPHM, without constructing one (used to estimate the memory use of a run)
+ * @param M dimension of sp space
+ * @param i the block index: 0 or 1 for the S=1/2 and S=3/2 block
+ * @return the dimension of block i
+ */
+int PPHM::block_dim(int M,int i){
+
+   if(i == 0)
+      return M*M*M/8;
+   else
+      return M*M*(M - 2)/16;
+
+}
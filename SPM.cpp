@@ -101,6 +101,21 @@ ostream &operator<<(ostream &output,const SPM &spm_p){
  */
 void SPM::bar(double scale,const TPM &tpm){
 
+   //the vector kernel, see MapStreams
+   const MapStreams *vec = MapStreams::get(M);
+
+   if(vec != 0){
+
+      const double *tp[2] = {tpm[0].gMatrix()[0],tpm[1].gMatrix()[0]};
+
+      vec->bar(scale,tp,this->gMatrix()[0]);
+
+      this->symmetrize();
+
+      return;
+
+   }
+
    //hulpvariabele
    double ward;
 
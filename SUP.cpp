@@ -116,15 +116,64 @@ SUP::SUP(const SUP &SZ_c){
 
 }
 
+/**
+ * move constructor: takes over the blocks of SZ_m without copying. SZ_m is left empty and can only be destructed or assigned to,
+ * a copy assignment allocates new blocks.
+ * @param SZ_m SUP to be moved into this
+ */
+SUP::SUP(SUP &&SZ_m){
+
+   this->M = SZ_m.M;
+   this->N = SZ_m.N;
+   this->n_tp = SZ_m.n_tp;
+   this->dim = SZ_m.dim;
+
+   SZ_tp = SZ_m.SZ_tp;
+   SZ_m.SZ_tp = 0;
+
+#ifdef __G_CON
+
+   this->n_ph = SZ_m.n_ph;
+
+   SZ_ph = SZ_m.SZ_ph;
+   SZ_m.SZ_ph = 0;
+
+#endif
+
+#ifdef __T1_CON
+
+   this->n_dp = SZ_m.n_dp;
+
+   SZ_dp = SZ_m.SZ_dp;
+   SZ_m.SZ_dp = 0;
+
+#endif
+
+#ifdef __T2_CON
+
+   this->n_pph = SZ_m.n_pph;
+
+   SZ_pph = SZ_m.SZ_pph;
+   SZ_m.SZ_pph = 0;
+
+#endif
+
+}
+
 /**
  * Destructor
  */
 SUP::~SUP(){
 
-   for(int i = 0;i < 2;++i)
-      delete SZ_tp[i];
+   //a SUP that has been moved has no memory left
+   if(SZ_tp != 0){
 
-   delete [] SZ_tp;
+      for(int i = 0;i < 2;++i)
+         delete SZ_tp[i];
+
+      delete [] SZ_tp;
+
+   }
 
 #ifdef __G_CON
    
@@ -214,6 +263,34 @@ SUP &SUP::operator-=(const SUP &SZ_pl){
  */
 SUP &SUP::operator=(const SUP &SZ_c){
 
+   //a SUP that has been moved gets new blocks
+   if(SZ_tp == 0){
+
+      SZ_tp = new TPM * [2];
+
+      for(int i = 0;i < 2;++i)
+         SZ_tp[i] = new TPM(M,N);
+
+#ifdef __G_CON
+
+      SZ_ph = new PHM(M,N);
+
+#endif
+
+#ifdef __T1_CON
+
+      SZ_dp = new DPM(M,N);
+
+#endif
+
+#ifdef __T2_CON
+
+      SZ_pph = new PPHM(M,N);
+
+#endif
+
+   }
+
    (*SZ_tp[0]) = (*SZ_c.SZ_tp[0]);
    (*SZ_tp[1]) = (*SZ_c.SZ_tp[1]);
 
@@ -239,6 +316,106 @@ SUP &SUP::operator=(const SUP &SZ_c){
 
 }
 
+/**
+ * move assignment: swaps the blocks of (*this) and SZ_m, no numbers are copied
+ * @param SZ_m SUP to be moved into this
+ */
+SUP &SUP::operator=(SUP &&SZ_m){
+
+   this->swap(SZ_m);
+
+   return *this;
+
+}
+
+/**
+ * Evaluate the linear combination coef[0] term[0] + ... + coef[K-1] term[K-1] into (*this) part by part, see Matrix::lincomb
+ * @param K number of terms
+ * @param coef the coefficients
+ * @param term the SUP's
+ */
+SUP &SUP::lincomb(int K,const double *coef,const SUP * const *term){
+
+   const BlockMatrix **term_p = new const BlockMatrix * [K + 1];
+
+   for(int i = 0;i < 2;++i){
+
+      for(int k = 0;k < K;++k)
+         term_p[k] = term[k]->SZ_tp[i];
+
+      SZ_tp[i]->lincomb(K,coef,term_p);
+
+   }
+
+#ifdef __G_CON
+
+   for(int k = 0;k < K;++k)
+      term_p[k] = term[k]->SZ_ph;
+
+   SZ_ph->lincomb(K,coef,term_p);
+
+#endif
+
+#ifdef __T1_CON
+
+   for(int k = 0;k < K;++k)
+      term_p[k] = term[k]->SZ_dp;
+
+   SZ_dp->lincomb(K,coef,term_p);
+
+#endif
+
+#ifdef __T2_CON
+
+   for(int k = 0;k < K;++k)
+      term_p[k] = term[k]->SZ_pph;
+
+   SZ_pph->lincomb(K,coef,term_p);
+
+#endif
+
+   delete [] term_p;
+
+   return *this;
+
+}
+
+/**
+ * Swap the content of (*this) and SZ_sw by swapping the pointers to the blocks, O(1)
+ * @param SZ_sw SUP to swap with, must have the same M and N
+ */
+void SUP::swap(SUP &SZ_sw){
+
+   TPM **hulp = SZ_tp;
+   SZ_tp = SZ_sw.SZ_tp;
+   SZ_sw.SZ_tp = hulp;
+
+#ifdef __G_CON
+
+   PHM *hulp_ph = SZ_ph;
+   SZ_ph = SZ_sw.SZ_ph;
+   SZ_sw.SZ_ph = hulp_ph;
+
+#endif
+
+#ifdef __T1_CON
+
+   DPM *hulp_dp = SZ_dp;
+   SZ_dp = SZ_sw.SZ_dp;
+   SZ_sw.SZ_dp = hulp_dp;
+
+#endif
+
+#ifdef __T2_CON
+
+   PPHM *hulp_pph = SZ_pph;
+   SZ_pph = SZ_sw.SZ_pph;
+   SZ_sw.SZ_pph = hulp_pph;
+
+#endif
+
+}
+
 /**
  * overload operator = number, all the blockmatrices in SUP are put equal to the number a.
  * e.g. SZ = 0 makes all the Matrix elements zero.
@@ -834,25 +1011,8 @@ SUP &SUP::mprod(const SUP &A,const SUP &B){
 void SUP::fill(const TPM &tpm){
 
    *SZ_tp[0] = tpm;
-   SZ_tp[1]->Q(1,tpm);
-
-#ifdef __G_CON
-   
-   SZ_ph->G(tpm);
 
-#endif
-
-#ifdef __T1_CON
-   
-   SZ_dp->T(tpm);
-
-#endif
-
-#ifdef __T2_CON
-   
-   SZ_pph->T(tpm);
-
-#endif
+   this->fill();
 
 }
 
@@ -862,23 +1022,39 @@ void SUP::fill(const TPM &tpm){
  */
 void SUP::fill(){
 
-   SZ_tp[1]->Q(1,*SZ_tp[0]);
+   //all the up maps use the same SPM of the input TPM, and Q and T1 also the same np part: construct them only once
+   SPM spm(1.0/(N - 1.0),*SZ_tp[0]);
+
+   double ward = 1.0/(N*(N - 1.0)) * SZ_tp[0]->trace() * 2.0;
+
+   SZ_tp[1]->Q(1.0,ward,spm,*SZ_tp[0]);
 
 #ifdef __G_CON
 
-   SZ_ph->G(*SZ_tp[0]);
+   SZ_ph->G(spm,*SZ_tp[0]);
 
 #endif 
 
+   //the large T1 and T2 blocks can be out-of-core, see Matrix::set_mmap: they are read in ahead and dropped when they are filled
+#ifdef __T2_CON
+
+   SZ_pph->prefetch();
+
+#endif
+
 #ifdef __T1_CON
 
-   SZ_dp->T(*SZ_tp[0]);
+   SZ_dp->T(1.0,ward,spm,*SZ_tp[0]);
+
+   SZ_dp->release();
 
 #endif 
 
 #ifdef __T2_CON
 
-   SZ_pph->T(*SZ_tp[0]);
+   SZ_pph->T(spm,*SZ_tp[0]);
+
+   SZ_pph->release();
 
 #endif 
 
@@ -1049,31 +1225,223 @@ double SUP::line_search(const SUP &DZ,const SUP &S,const SUP &Z,double max_dev)
 }
 
 /**
- * Seperate SUP into two SUP's, a positive and negative semidefinite part.
- * @param p positive (plus) output part
- * @param m negative (minus) output part
+ * One inner iteration of the boundary point method as a task graph: the affine projection, the shift with the primal matrix, the
+ * separation in a plus and minus part and the collaps of the minus part. The affine projection is done in one pass:\n\n
+ * gamma = proj_Tr( S^-1( collaps(Z) + rhs ) ) + u\n
+ * this = diag[gamma Q(gamma) ( G(gamma) T1(gamma) T2(gamma) ) ]\n\n
+ * Because all maps are linear, the constant parts of the projection (the hamiltonian, u^0 and the primal matrix) are collapsed once
+ * into rhs, and the shift with u^0 = fill(u) is free. After gamma is calculated every block of the SUP is independent:
+ * for every condition a task fills its block, adds -1/sigma X, separates it (with a task for every spinblock, see BlockMatrix::sep_pm)
+ * and calculates the parts of its down map (see DownMaps). The idle threads steal the tasks of the other conditions, so the eigensolvers
+ * of the large T2 blocks overlap with the maps and eigensolvers of the small blocks. Only when the BLAS threads can't be set per task,
+ * the blocks that get more than one of them are separated after the tasks, one at a time (see ThreadBudget::alone). The parts of the down
+ * maps are added in a fixed order, so the result doesn't depend on the number of threads.\n\n
+ * On exit Z = W_+ and (*this) = V = -sigma W_-, with W = fill(gamma) - X/sigma, and v = collaps(V).
+ * @param Z input SUP, the plus part on exit
+ * @param rhs the TPM to be added to the collapsed Z
+ * @param u the TPM whose image is added to the projection
+ * @param gamma output: the TPM that is filled into (*this)
+ * @param X the primal matrix
+ * @param sigma the penalty parameter
+ * @param single if true the blocks are diagonalized in single precision, see Matrix::sep_pm
+ * @param m_f if not 0, the factors of the blocks of the minus part are stored here, see Matrix::sep_pm
+ * @param stats if not 0, the blocks that were definite are counted here
+ * @param v output: the collapsed minus part, not projected onto traceless space
+ * With MPI every rank handles only its own blocks and the collapsed TPM's are summed over the ranks, see Distribution.
  */
-void SUP::sep_pm(SUP &p,SUP &m){
+void SUP::proj_U_sep(SUP &Z,const TPM &rhs,const TPM &u,TPM &gamma,const LRSUP &X,double sigma,bool single,LRSUP *m_f,SepStats *stats,TPM &v){
 
-   for(int i = 0;i < 2;++i)
-      SZ_tp[i]->sep_pm(p.tpm(i),m.tpm(i));
+   TPM b(M,N);
 
-#ifdef __G_CON
+   b.collaps(1,Z);
+
+   //with MPI every rank only has its own blocks of Z, see Distribution
+   Distribution::sum(b);
+
+   b += rhs;
+
+   gamma.S(-1,b);
+
+   gamma.proj_Tr();
+
+   gamma += u;
+
+   //shared by the up maps, see SUP::fill
+   SPM spm(1.0/(N - 1.0),gamma);
 
-      SZ_ph->sep_pm(p.phm(),m.phm());
+   double ward = 1.0/(N*(N - 1.0)) * gamma.trace() * 2.0;
+
+   double alpha = -1.0/sigma;
+   double scale = -sigma;
+
+   if(stats != 0)
+      stats->tick();
+
+   DownMaps down(M,N);
+
+   #pragma omp taskgroup
+   {
+
+      //the largest blocks first, they are on the critical path
+#ifdef __T2_CON
+
+      #pragma omp task shared(Z,gamma,X,spm,down)
+      {
+
+         SZ_pph->prefetch();
+
+         SZ_pph->T(spm,gamma);
+
+         X.pph().add_to(alpha,*SZ_pph);
+
+         SZ_pph->sep_pm(Z.pphm(),*SZ_pph,single,scale,m_f ? &m_f->pph() : 0,stats ? stats->counts(4) : 0);
+
+         //else the condition is finished after the blocks that run alone
+         if(SZ_pph->n_alone() == 0){
+
+            down.T2(*SZ_pph);
+
+            //out-of-core blocks are dropped from memory after their last use in this iteration, see Matrix::release
+            SZ_pph->release();
+            Z.pphm().release();
+
+         }
+
+      }
 
 #endif
 
 #ifdef __T1_CON
 
-      SZ_dp->sep_pm(p.dpm(),m.dpm());
+      #pragma omp task shared(Z,gamma,X,spm,down)
+      {
+
+         SZ_dp->T(1.0,ward,spm,gamma);
+
+         X.dp().add_to(alpha,*SZ_dp);
+
+         SZ_dp->sep_pm(Z.dpm(),*SZ_dp,single,scale,m_f ? &m_f->dp() : 0,stats ? stats->counts(3) : 0);
+
+         if(SZ_dp->n_alone() == 0){
+
+            down.T1(*SZ_dp);
+
+            SZ_dp->release();
+            Z.dpm().release();
+
+         }
+
+      }
 
 #endif
 
+#ifdef __G_CON
+
+      #pragma omp task shared(Z,gamma,X,spm,down)
+      {
+
+         SZ_ph->G(spm,gamma);
+
+         X.ph().add_to(alpha,*SZ_ph);
+
+         SZ_ph->sep_pm(Z.phm(),*SZ_ph,single,scale,m_f ? &m_f->ph() : 0,stats ? stats->counts(2) : 0);
+
+         if(SZ_ph->n_alone() == 0)
+            down.G(*SZ_ph);
+
+      }
+
+#endif
+
+      #pragma omp task shared(Z,gamma,X,spm,down)
+      {
+
+         SZ_tp[1]->Q(1.0,ward,spm,gamma);
+
+         X.tp(1).add_to(alpha,*SZ_tp[1]);
+
+         SZ_tp[1]->sep_pm(Z.tpm(1),*SZ_tp[1],single,scale,m_f ? &m_f->tp(1) : 0,stats ? stats->counts(1) : 0);
+
+         if(SZ_tp[1]->n_alone() == 0)
+            down.Q(*SZ_tp[1]);
+
+      }
+
+      *SZ_tp[0] = gamma;
+
+      X.tp(0).add_to(alpha,*SZ_tp[0]);
+
+      SZ_tp[0]->sep_pm(Z.tpm(0),*SZ_tp[0],single,scale,m_f ? &m_f->tp(0) : 0,stats ? stats->counts(0) : 0);
+
+      if(SZ_tp[0]->n_alone() == 0)
+         down.P(*SZ_tp[0]);
+
+   }
+
+   //the blocks that run alone get more than one BLAS thread from a library that can only set them for the whole program: they are
+   //separated one after the other when all the tasks are done, and then the down maps of their conditions follow (see ThreadBudget)
 #ifdef __T2_CON
 
-      SZ_pph->sep_pm(p.pphm(),m.pphm());
+   if(SZ_pph->n_alone() > 0){
+
+      SZ_pph->sep_pm(Z.pphm(),*SZ_pph,single,scale,m_f ? &m_f->pph() : 0,stats ? stats->counts(4) : 0,true);
+
+      down.T2(*SZ_pph);
+
+      SZ_pph->release();
+      Z.pphm().release();
+
+   }
+
+#endif
+
+#ifdef __T1_CON
+
+   if(SZ_dp->n_alone() > 0){
+
+      SZ_dp->sep_pm(Z.dpm(),*SZ_dp,single,scale,m_f ? &m_f->dp() : 0,stats ? stats->counts(3) : 0,true);
+
+      down.T1(*SZ_dp);
+
+      SZ_dp->release();
+      Z.dpm().release();
+
+   }
+
+#endif
+
+#ifdef __G_CON
+
+   if(SZ_ph->n_alone() > 0){
+
+      SZ_ph->sep_pm(Z.phm(),*SZ_ph,single,scale,m_f ? &m_f->ph() : 0,stats ? stats->counts(2) : 0,true);
+
+      down.G(*SZ_ph);
+
+   }
 
 #endif
 
+   if(SZ_tp[1]->n_alone() > 0){
+
+      SZ_tp[1]->sep_pm(Z.tpm(1),*SZ_tp[1],single,scale,m_f ? &m_f->tp(1) : 0,stats ? stats->counts(1) : 0,true);
+
+      down.Q(*SZ_tp[1]);
+
+   }
+
+   if(SZ_tp[0]->n_alone() > 0){
+
+      SZ_tp[0]->sep_pm(Z.tpm(0),*SZ_tp[0],single,scale,m_f ? &m_f->tp(0) : 0,stats ? stats->counts(0) : 0,true);
+
+      down.P(*SZ_tp[0]);
+
+   }
+
+
+   down.sum(v);
+
+   Distribution::sum(v);
+
 }
+
@@ -0,0 +1,197 @@
+#include <iostream>
+#include <fstream>
+
+using std::endl;
+using std::ostream;
+
+#include "include.h"
+
+/**
+ * constructor: the block structure is taken from a SUP and all the counters are set to zero
+ * @param shape SUP of which the separation is monitored
+ */
+SepStats::SepStats(const SUP &shape){
+
+   for(int k = 0;k < n_part;++k)
+      nr[k] = 0;
+
+   for(int i = 0;i < 2;++i)
+      nr[i] = shape.tpm(i).gnr();
+
+#ifdef __G_CON
+
+   nr[2] = shape.phm().gnr();
+
+#endif
+
+#ifdef __T1_CON
+
+   nr[3] = shape.dpm().gnr();
+
+#endif
+
+#ifdef __T2_CON
+
+   nr[4] = shape.pphm().gnr();
+
+#endif
+
+   for(int k = 0;k < n_part;++k){
+
+      dim[k] = new int [nr[k] + 1];
+      n_def[k] = new long [2*nr[k] + 1];
+
+   }
+
+   for(int i = 0;i < 2;++i)
+      for(int j = 0;j < nr[i];++j)
+         dim[i][j] = shape.tpm(i).gdim(j);
+
+#ifdef __G_CON
+
+   for(int j = 0;j < nr[2];++j)
+      dim[2][j] = shape.phm().gdim(j);
+
+#endif
+
+#ifdef __T1_CON
+
+   for(int j = 0;j < nr[3];++j)
+      dim[3][j] = shape.dpm().gdim(j);
+
+#endif
+
+#ifdef __T2_CON
+
+   for(int j = 0;j < nr[4];++j)
+      dim[4][j] = shape.pphm().gdim(j);
+
+#endif
+
+   calls = 0;
+
+   for(int k = 0;k < n_part;++k)
+      for(int j = 0;j < 2*nr[k];++j)
+         n_def[k][j] = 0;
+
+}
+
+/**
+ * copy constructor
+ * @param stats_copy The SepStats to be copied into the object you are constructing
+ */
+SepStats::SepStats(const SepStats &stats_copy){
+
+   for(int k = 0;k < n_part;++k){
+
+      nr[k] = stats_copy.nr[k];
+
+      dim[k] = new int [nr[k] + 1];
+      n_def[k] = new long [2*nr[k] + 1];
+
+   }
+
+   copy(stats_copy);
+
+}
+
+/**
+ * Destructor
+ */
+SepStats::~SepStats(){
+
+   for(int k = 0;k < n_part;++k){
+
+      delete [] dim[k];
+      delete [] n_def[k];
+
+   }
+
+}
+
+/**
+ * overload the equality operator, both objects have to be constructed from the same SUP structure
+ * @param stats_copy The SepStats to be copied into this
+ */
+SepStats &SepStats::operator=(const SepStats &stats_copy){
+
+   copy(stats_copy);
+
+   return *this;
+
+}
+
+/**
+ * copy the counters and dimensions of stats_copy into this, the memory has to be allocated already
+ * @param stats_copy The SepStats to be copied
+ */
+void SepStats::copy(const SepStats &stats_copy){
+
+   calls = stats_copy.calls;
+
+   for(int k = 0;k < n_part;++k){
+
+      for(int j = 0;j < nr[k];++j)
+         dim[k][j] = stats_copy.dim[k][j];
+
+      for(int j = 0;j < 2*nr[k];++j)
+         n_def[k][j] = stats_copy.n_def[k][j];
+
+   }
+
+}
+
+/**
+ * @param part 0 for P, 1 for Q, 2 for G, 3 for T1 and 4 for T2
+ * @return the counters of part, to be passed to BlockMatrix::sep_pm
+ */
+long *SepStats::counts(int part){
+
+   return n_def[part];
+
+}
+
+/**
+ * count one more call to sep_pm
+ */
+void SepStats::tick(){
+
+   ++calls;
+
+}
+
+/**
+ * @return the number of calls to sep_pm
+ */
+long SepStats::gcalls() const{
+
+   return calls;
+
+}
+
+/**
+ * Add the counts of all the MPI ranks: every rank only separates its own blocks, see Distribution
+ */
+void SepStats::reduce(){
+
+   for(int k = 0;k < n_part;++k)
+      Distribution::sum(n_def[k],2*nr[k]);
+
+}
+
+ostream &operator<<(ostream &output,const SepStats &stats_p){
+
+   const char *name[SepStats::n_part] = {"P","Q","G","T1","T2"};
+
+   double calls = stats_p.calls > 0 ? stats_p.calls : 1;
+
+   for(int k = 0;k < SepStats::n_part;++k)
+      for(int j = 0;j < stats_p.nr[k];++j)
+         output << name[k] << "\tblock " << j << "\tdim " << stats_p.dim[k][j] << "\tpositive definite: " << stats_p.n_def[k][2*j]/calls
+            << "\tnegative definite: " << stats_p.n_def[k][2*j + 1]/calls << endl;
+
+   return output;
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
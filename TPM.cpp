@@ -1,6 +1,8 @@
 #include <iostream>
 #include <cmath>
 #include <fstream>
+#include <utility>
+#include <vector>
 
 using std::ostream;
 using std::ofstream;
@@ -8,6 +10,7 @@ using std::ifstream;
 using std::cout;
 using std::endl;
 using std::ios;
+using std::vector;
 
 #include "include.h"
 
@@ -30,13 +33,19 @@ TPM::TPM(int M,int N) : BlockMatrix(2) {
    this->M = M;
 
    //set the dimension and degeneracy of the two blocks:
-   this->setMatrixDim(0,M*(M + 2)/8,1);
-   this->setMatrixDim(1,M*(M - 2)/8,3);
+   this->setMatrixDim(0,block_dim(M,0),1);
+   this->setMatrixDim(1,block_dim(M,1),3);
 
-   if(counter == 0)
-      constr_lists();
+   //the lists are shared by all objects, which can be constructed in concurrent tasks
+   #pragma omp critical(tpm_lists)
+   {
 
-   ++counter;
+      if(counter == 0)
+         constr_lists();
+
+      ++counter;
+
+   }
 
 }
 
@@ -50,10 +59,36 @@ TPM::TPM(const TPM &tpm_c) : BlockMatrix(tpm_c){
    this->N = tpm_c.gN();
    this->M = tpm_c.gM();
 
-   if(counter == 0)
-      constr_lists();
+   #pragma omp critical(tpm_lists)
+   {
+
+      if(counter == 0)
+         constr_lists();
+
+      ++counter;
+
+   }
+
+}
+
+/**
+ * move constructor: takes over the blocks of tpm_m without copying, see BlockMatrix(BlockMatrix &&)
+ * @param tpm_m object that will be moved into this.
+ */
+TPM::TPM(TPM &&tpm_m) : BlockMatrix(std::move(tpm_m)){
+
+   this->N = tpm_m.gN();
+   this->M = tpm_m.gM();
+
+   #pragma omp critical(tpm_lists)
+   {
+
+      if(counter == 0)
+         constr_lists();
 
-   ++counter;
+      ++counter;
+
+   }
 
 }
 
@@ -63,30 +98,47 @@ TPM::TPM(const TPM &tpm_c) : BlockMatrix(tpm_c){
  */
 TPM::~TPM(){
 
-   if(counter == 1){
+   #pragma omp critical(tpm_lists)
+   {
 
-      for(int S = 0;S < 2;++S){
+      if(counter == 1){
 
-         delete [] _6j[S];
+         for(int S = 0;S < 2;++S){
 
-         delete [] s2t[S][0];
-         delete [] s2t[S];
+            delete [] _6j[S];
 
-         for(int i = 0;i < this->gdim(S);++i)
-            delete [] t2s[S][i];
+            delete [] s2t[S][0];
+            delete [] s2t[S];
 
-         delete [] t2s[S];
+            for(int i = 0;i < this->gdim(S);++i)
+               delete [] t2s[S][i];
 
-      }
+            delete [] t2s[S];
+
+         }
 
-      delete [] s2t;
-      delete [] t2s;
+         delete [] s2t;
+         delete [] t2s;
 
-      delete [] _6j;
+         delete [] _6j;
+
+      }
+
+      --counter;
 
    }
 
-   --counter;
+}
+
+/**
+ * move assignment: swaps the blocks of (*this) and tpm_m, no numbers are copied
+ * @param tpm_m object that will be moved into this.
+ */
+TPM &TPM::operator=(TPM &&tpm_m){
+
+   this->swap(tpm_m);
+
+   return *this;
 
 }
 
@@ -358,67 +410,114 @@ void TPM::Q(int option,double A,double B,double C,const TPM &tpm_d){
    //de trace*2 omdat mijn definitie van trace in berekeningen over alle (alpha,beta) loopt
    double ward = B*tpm_d.trace()*2.0;
 
-   int sign;
+   this->Q(A,ward,spm,tpm_d);
 
-   double norm;
+}
+
+/**
+ * The spincoupled Q-like map with the np and sp part already calculated, so that different maps of the same TPM can share them,
+ * see SUP::fill and TPM::collaps.
+ * @param A factor in front of the two particle piece of the map
+ * @param ward the np part: B times twice the trace of tpm_d
+ * @param spm the sp part: the bar of tpm_d scaled with C
+ * @param tpm_d the TPM of which the Q-like map is taken and saved in this.
+ */
+void TPM::Q(double A,double ward,const SPM &spm,const TPM &tpm_d){
+
+   //the kernel of every block is specialized on its spin
+   static void (TPM::*const kernel[2])(double,double,const SPM &,const TPM &) = {&TPM::Q_block<0>,&TPM::Q_block<1>};
+
+   //the vector kernels, 0 if the scalar kernels are used
+   const MapStreams *vec = MapStreams::get(M);
 
-   //loop over the spinblocks
    for(int S = 0;S < 2;++S){
 
-      //symmetry or antisymmetry?
-      sign = 1 - 2*S;
+      //the block of another MPI rank is not filled, see Distribution
+      if((*this)[S].gremote())
+         continue;
 
-      for(int i = 0;i < this->gdim(S);++i){
+      if(vec != 0)
+         vec->Q(S,A,ward,spm.gMatrix()[0],tpm_d[S].gMatrix()[0],(*this)[S].gMatrix()[0],(*this)[S].gnode());
+      else
+         (this->*kernel[S])(A,ward,spm,tpm_d);
 
-         int a = t2s[S][i][0];
-         int b = t2s[S][i][1];
+   }
 
-         for(int j = i;j < this->gdim(S);++j){
+   this->symmetrize();
 
-            int c = t2s[S][j][0];
-            int d = t2s[S][j][1];
+}
 
-            //determine the norm for the basisset
-            norm = 1.0;
+/**
+ * The Q-like map of TPM::Q(A,ward,spm,tpm_d) for the block with spin S, which is known at compile time. The elements of the blocks
+ * and the SPM are indexed directly.
+ * @param A factor in front of the two particle piece of the map
+ * @param ward the np part
+ * @param spm the sp part
+ * @param tpm_d the TPM of which the Q-like map is taken
+ */
+template<int S>
+void TPM::Q_block(double A,double ward,const SPM &spm,const TPM &tpm_d){
 
-            if(S == 0){
+   int n = this->gdim(S);
+   int m = spm.gn();
 
-               if(a == b)
-                  norm /= std::sqrt(2.0);
+   double *out = (*this)[S].gMatrix()[0];
 
-               if(c == d)
-                  norm /= std::sqrt(2.0);
+   const double *in = tpm_d[S].gMatrix()[0];
+   const double *sp = spm.gMatrix()[0];
 
-            }
+   //row i has gdim - i elements: every row is a task on the node of the block (see Numa::run), the long rows are started first and idle
+   //threads steal them, which balances the triangle. Every element is still calculated by one thread, so the result doesn't depend on
+   //the number of threads. Outside a parallel region the tasks are executed by the calling thread.
+   Numa::run(n,(*this)[S].gnode(),[&](int i){
 
-            //here starts the Q-map
+      int a = t2s[S][i][0];
+      int b = t2s[S][i][1];
 
-            //the tp part
-            (*this)(S,i,j) = A*tpm_d(S,i,j);
+      for(int j = i;j < n;++j){
 
-            //the np part
-            if(i == j)
-               (*this)(S,i,i) += ward;
+         int c = t2s[S][j][0];
+         int d = t2s[S][j][1];
 
-            //and four sp parts:
-            if(a == c)
-               (*this)(S,i,j) -= norm*spm(b,d);
+         //determine the norm for the basisset
+         double norm = 1.0;
 
-            if(b == c)
-               (*this)(S,i,j) -= sign*norm*spm(a,d);
+         if constexpr (S == 0){
 
-            if(a == d)
-               (*this)(S,i,j) -= sign*norm*spm(b,c);
+            if(a == b)
+               norm /= std::sqrt(2.0);
 
-            if(b == d)
-               (*this)(S,i,j) -= norm*spm(a,c);
+            if(c == d)
+               norm /= std::sqrt(2.0);
 
          }
-      }
 
-   }
+         //here starts the Q-map
 
-   this->symmetrize();
+         //the tp part
+         double ward_ij = A*in[i + j*n];
+
+         //the np part
+         if(i == j)
+            ward_ij += ward;
+
+         //and four sp parts:
+         if(a == c)
+            ward_ij -= norm*sp[b + d*m];
+
+         if(b == c)
+            ward_ij -= Spin<S>::sign*norm*sp[a + d*m];
+
+         if(a == d)
+            ward_ij -= Spin<S>::sign*norm*sp[b + c*m];
+
+         if(b == d)
+            ward_ij -= norm*sp[a + c*m];
+
+         out[i + j*n] = ward_ij;
+
+      }
+   });
 
 }
 
@@ -677,38 +776,57 @@ void TPM::S(int option,const TPM &tpm_d){
  */
 void TPM::collaps(int option,const SUP &S){
 
-   *this = S.tpm(0);
+   //all down maps are sums of a tp, np, sp and ph part: the parts of the different blocks are independent tasks, DownMaps::sum
+   //adds them in a fixed order and constructs (*this) in one pass (see TPM::T)
+   DownMaps down(M,N);
 
-   TPM hulp(M,N);
+   down.P(S.tpm(0));
 
-   hulp.Q(1,S.tpm(1));
+   //the large T1 and T2 blocks can be out-of-core, see Matrix::set_mmap: they are read in ahead and dropped after their last use
+#ifdef __T2_CON
 
-   *this += hulp;
+   S.pphm().prefetch();
 
-#ifdef __G_CON
+#endif
 
-   hulp.G(S.phm());
+   #pragma omp taskgroup
+   {
 
-   *this += hulp;
+      #pragma omp task shared(down,S)
+      down.Q(S.tpm(1));
+
+#ifdef __G_CON
+
+      #pragma omp task shared(down,S)
+      down.G(S.phm());
 
 #endif
 
 #ifdef __T1_CON
 
-   hulp.T(S.dpm());
+      #pragma omp task shared(down,S)
+      {
 
-   *this += hulp;
+         down.T1(S.dpm());
+
+         S.dpm().release();
+
+      }
 
 #endif
 
 #ifdef __T2_CON
-   
-   hulp.T(S.pphm());
 
-   *this += hulp;
+      down.T2(S.pphm());
+
+      S.pphm().release();
 
 #endif
 
+   }
+
+   down.sum(*this);
+
    if(option == 1)
       this->proj_Tr();
 
@@ -765,6 +883,8 @@ void TPM::sp_pairing(double pair_coupling){
 
             if(a == b && c == d)
                (*this)(S,i,j) = -2.0*pair_coupling*x[a]*x[c];
+            else
+               (*this)(S,i,j) = 0.0;
 
          }
 
@@ -775,6 +895,7 @@ void TPM::sp_pairing(double pair_coupling){
    this->symmetrize();
 
    delete [] E;
+   delete [] x;
 
 }
 
@@ -857,58 +978,94 @@ void TPM::G(const PHM &phm){
 
    SPM spm(1.0/(N - 1.0),phm);
 
-   int sign;
-   int a,b,c,d;
+   //the kernel of every block is specialized on its spin
+   static void (TPM::*const kernel[2])(const SPM &,const PHM &) = {&TPM::G_block<0>,&TPM::G_block<1>};
+
+   const MapStreams *vec = MapStreams::get(M);
+
+   const double *ph[2] = {phm[0].gMatrix()[0],phm[1].gMatrix()[0]};
 
    for(int S = 0;S < 2;++S){
 
-      sign = 1 - 2*S;
+      if(vec != 0)
+         vec->G_down(S,this->gdeg(0)*_6j[S][0],this->gdeg(1)*_6j[S][1],spm.gMatrix()[0],ph,(*this)[S].gMatrix()[0]);
+      else
+         (this->*kernel[S])(spm,phm);
 
-      for(int i = 0;i < this->gdim(S);++i){
+   }
 
-         a = t2s[S][i][0];
-         b = t2s[S][i][1];
+   this->symmetrize();
 
-         for(int j = i;j < this->gdim(S);++j){
+}
 
-            c = t2s[S][j][0];
-            d = t2s[S][j][1];
+/**
+ * The G down map of TPM::G for the block with spin S, which is known at compile time.
+ * @param spm the SPM of phm, scaled with 1/(N-1)
+ * @param phm input PHM
+ */
+template<int S>
+void TPM::G_block(const SPM &spm,const PHM &phm){
 
-            //init
-            (*this)(S,i,j) = 0.0;
+   int n = this->gdim(S);
+   int m = spm.gn();
 
-            //ph part
-            for(int Z = 0;Z < 2;++Z)
-               (*this)(S,i,j) -= this->gdeg(Z)*_6j[S][Z] * ( phm(Z,a,d,c,b) + phm(Z,b,c,d,a) + sign*phm(Z,b,d,c,a) + sign*phm(Z,a,c,d,b) );
+   double *out = (*this)[S].gMatrix()[0];
 
-            //4 sp parts
-            if(b == d)
-               (*this)(S,i,j) += spm(a,c);
+   const double *sp = spm.gMatrix()[0];
 
-            if(a == c)
-               (*this)(S,i,j) += spm(b,d);
+   const double *ph[2] = {phm[0].gMatrix()[0],phm[1].gMatrix()[0]};
+   int n_ph = phm.gdim(0);
 
-            if(a == d)
-               (*this)(S,i,j) += sign*spm(b,c);
+   #pragma omp taskloop firstprivate(out,sp,ph) grainsize(1)
+   for(int i = 0;i < n;++i){
 
-            if(b == c)
-               (*this)(S,i,j) += sign*spm(a,d);
+      int a = t2s[S][i][0];
+      int b = t2s[S][i][1];
+
+      for(int j = i;j < n;++j){
+
+         int c = t2s[S][j][0];
+         int d = t2s[S][j][1];
+
+         //init
+         double ward = 0.0;
+
+         //ph part
+         for(int Z = 0;Z < 2;++Z)
+            ward -= this->gdeg(Z)*Spin<S>::_6j[Z] * ( PHM::sp(ph[Z],n_ph,a,d,c,b) + PHM::sp(ph[Z],n_ph,b,c,d,a)
+
+                  + Spin<S>::sign*PHM::sp(ph[Z],n_ph,b,d,c,a) + Spin<S>::sign*PHM::sp(ph[Z],n_ph,a,c,d,b) );
+
+         //4 sp parts
+         if(b == d)
+            ward += sp[a + c*m];
+
+         if(a == c)
+            ward += sp[b + d*m];
+
+         if(a == d)
+            ward += Spin<S>::sign*sp[b + c*m];
+
+         if(b == c)
+            ward += Spin<S>::sign*sp[a + d*m];
+
+         //norm of the basisset:
+         if constexpr (S == 0){
 
-            //norm of the basisset:
             if(a == b)
-               (*this)(S,i,j) /= std::sqrt(2.0);
+               ward /= std::sqrt(2.0);
 
             if(c == d)
-               (*this)(S,i,j) /= std::sqrt(2.0);
+               ward /= std::sqrt(2.0);
 
          }
 
+         out[i + j*n] = ward;
+
       }
 
    }
 
-   this->symmetrize();
-
 }
 
 /**
@@ -917,20 +1074,16 @@ void TPM::G(const PHM &phm){
  */
 void TPM::bar(const DPM &dpm){
 
-   int a,b,c,d;
-
-   double ward;
-
-   //first the S = 0 part, easiest:
-   for(int i = 0;i < this->gdim(0);++i){
+   //first the S = 0 part, easiest: it only reads the S = 1/2 block of the DPM, so every row is a task on the node of that block
+   Numa::run(this->gdim(0),dpm[0].gnode(),[&](int i){
 
-      a = t2s[0][i][0];
-      b = t2s[0][i][1];
+      int a = t2s[0][i][0];
+      int b = t2s[0][i][1];
 
       for(int j = i;j < this->gdim(0);++j){
 
-         c = t2s[0][j][0];
-         d = t2s[0][j][1];
+         int c = t2s[0][j][0];
+         int d = t2s[0][j][1];
 
          (*this)(0,i,j) = 0.0;
 
@@ -939,24 +1092,29 @@ void TPM::bar(const DPM &dpm){
             (*this)(0,i,j) += 2.0 * dpm(0,0,a,b,l,0,c,d,l);
 
       }
-   }
+   });
+
+   //then the S = 1 part: every element reads as much of both blocks of the DPM, so the rows are divided over their nodes
+   vector<int> node(this->gdim(1));
 
-   //then the S = 1 part:
-   for(int i = 0;i < this->gdim(1);++i){
+   for(int i = 0;i < this->gdim(1);++i)
+      node[i] = dpm[i % 2].gnode();
 
-      a = t2s[1][i][0];
-      b = t2s[1][i][1];
+   Numa::run(this->gdim(1),node.data(),[&](int i){
+
+      int a = t2s[1][i][0];
+      int b = t2s[1][i][1];
 
       for(int j = i;j < this->gdim(1);++j){
 
-         c = t2s[1][j][0];
-         d = t2s[1][j][1];
+         int c = t2s[1][j][0];
+         int d = t2s[1][j][1];
 
          (*this)(1,i,j) = 0.0;
 
          for(int Z = 0;Z < 2;++Z){//loop over the dpm blocks: S = 1/2 and 3/2 = Z + 1/2
 
-            ward = 0.0;
+            double ward = 0.0;
 
             for(int l = 0;l < M/2;++l)
                ward += dpm(Z,1,a,b,l,1,c,d,l);
@@ -968,7 +1126,7 @@ void TPM::bar(const DPM &dpm){
          }
 
       }
-   }
+   });
 
    this->symmetrize();
 
@@ -997,27 +1155,29 @@ void TPM::T(const DPM &dpm){
  */
 void TPM::bar(const PPHM &pphm){
 
-   int a,b,c,d;
+   for(int Z = 0;Z < 2;++Z){
 
-   double ward;
+      //every element reads as much of both blocks of the PPHM, so the rows are divided over their nodes, see Numa::run
+      vector<int> node(this->gdim(Z));
 
-   for(int Z = 0;Z < 2;++Z){
+      for(int i = 0;i < this->gdim(Z);++i)
+         node[i] = pphm[i % 2].gnode();
 
-      for(int i = 0;i < this->gdim(Z);++i){
+      Numa::run(this->gdim(Z),node.data(),[&](int i){
 
-         a = t2s[Z][i][0];
-         b = t2s[Z][i][1];
+         int a = t2s[Z][i][0];
+         int b = t2s[Z][i][1];
 
          for(int j = i;j < this->gdim(Z);++j){
 
-            c = t2s[Z][j][0];
-            d = t2s[Z][j][1];
+            int c = t2s[Z][j][0];
+            int d = t2s[Z][j][1];
 
             (*this)(Z,i,j) = 0.0;
 
             for(int S = 0;S < 2;++S){//loop over three particle spin: 1/2 and 3/2
 
-               ward = (2.0*(S + 0.5) + 1.0)/(2.0*Z + 1.0);
+               double ward = (2.0*(S + 0.5) + 1.0)/(2.0*Z + 1.0);
 
                for(int l = 0;l < M/2;++l)
                   (*this)(Z,i,j) += ward * pphm(S,Z,a,b,l,Z,c,d,l);
@@ -1025,7 +1185,7 @@ void TPM::bar(const PPHM &pphm){
             }
 
          }
-      }
+      });
 
    }
    
@@ -1051,6 +1211,20 @@ void TPM::T(const PPHM &pphm){
    SPM spm(M,N);
    spm.bar(0.5/(N - 1.0),pphm);
 
+   this->T(0.0,tpm,spm,phm);
+
+}
+
+/**
+ * The T2-like down map with all ingredients given: the tp part tpm, the np part ward, the sp part spm and the ph part phm.
+ * The down maps of all conditions are of this form, so collaps can accumulate all the parts first and do a single pass over the TPM.
+ * @param ward the np part, added to the diagonal
+ * @param tpm the tp part
+ * @param spm the sp part
+ * @param phm the ph part
+ */
+void TPM::T(double ward,const TPM &tpm,const SPM &spm,const PHM &phm){
+
    int a,b,c,d;
    int sign;
 
@@ -1060,6 +1234,7 @@ void TPM::T(const PPHM &pphm){
 
       sign = 1 - 2*S;
 
+      #pragma omp taskloop private(a,b,c,d,norm) shared(tpm,spm,phm) grainsize(1)
       for(int i = 0;i < this->gdim(S);++i){
 
          a = t2s[S][i][0];
@@ -1086,6 +1261,10 @@ void TPM::T(const PPHM &pphm){
             //first the tp part
             (*this)(S,i,j) = tpm(S,i,j);
 
+            //the np part
+            if(i == j)
+               (*this)(S,i,i) += ward;
+
             //sp part, 4 terms:
             if(b == d)
                (*this)(S,i,j) += norm * spm(a,c);
@@ -1157,3 +1336,18 @@ void TPM::in_sp(const char *filename){
    this->symmetrize();
 
 }
+
+/**
+ * The dimensions of the blocks of a TPM, without constructing one (used to estimate the memory use of a run)
+ * @param M dimension of sp space
+ * @param i the block index: 0 or 1 for the S=0 and S=1 block
+ * @return the dimension of block i
+ */
+int TPM::block_dim(int M,int i){
+
+   if(i == 0)
+      return M*(M + 2)/8;
+   else
+      return M*(M - 2)/8;
+
+}
@@ -0,0 +1,319 @@
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstdio>
+#include <dlfcn.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using std::endl;
+using std::ostream;
+
+#include "include.h"
+
+int ThreadBudget::threads = 1;
+double ThreadBudget::work = 0.0;
+int ThreadBudget::n_max = 0;
+int ThreadBudget::lib = 0;
+int (*ThreadBudget::set_local)(int) = 0;
+int ThreadBudget::copies = 1;
+int ThreadBudget::global = 1;
+
+namespace{
+
+   //the library names, indexed with ThreadBudget::lib
+   const char *lib_name[] = {"none","OpenBLAS","MKL","BLIS"};
+
+   /**
+    * @return the configuration string of OpenBLAS, which starts with its version
+    */
+   const char *openblas_config(){
+
+      char *(*config)() = (char *(*)()) dlsym(RTLD_DEFAULT,"openblas_get_config");
+
+      if(config == 0)
+         return "OpenBLAS";
+
+      return config();
+
+   }
+
+   /**
+    * Before version 0.3.7 OpenBLAS could corrupt its memory buffers when it was called from several threads at the same time
+    * @return true if the loaded OpenBLAS can be called from concurrent tasks
+    */
+   bool concurrent_safe(){
+
+      int major = 0,minor = 0,patch = 0;
+
+      if(std::sscanf(openblas_config(),"OpenBLAS %d.%d.%d",&major,&minor,&patch) != 3)
+         return true;
+
+      if(major != 0)
+         return major > 0;
+
+      if(minor != 3)
+         return minor > 3;
+
+      return patch >= 7;
+
+   }
+
+   /**
+    * set the number of BLAS threads of the whole program
+    * @param lib which library, see ThreadBudget::lib
+    * @param n the number of threads
+    */
+   void set_global(int lib,int n){
+
+      if(lib == 1){
+
+         void (*set)(int) = (void (*)(int)) dlsym(RTLD_DEFAULT,"openblas_set_num_threads");
+
+         set(n);
+
+      }
+      else if(lib == 2){
+
+         void (*set)(int) = (void (*)(int)) dlsym(RTLD_DEFAULT,"MKL_Set_Num_Threads");
+
+         if(set != 0)
+            set(n);
+
+      }
+      else if(lib == 3){
+
+         //dim_t of BLIS is a 64 bit integer
+         void (*set)(long) = (void (*)(long)) dlsym(RTLD_DEFAULT,"bli_thread_set_num_threads");
+
+         set(n);
+
+      }
+
+   }
+
+}
+
+/**
+ * constructor: set the BLAS threads of the current task to the share of a block of dimension n. MKL and OpenBLAS 0.3.27 or later
+ * set them for the calling thread only. The other libraries can only set them for the whole program: for a block that runs alone
+ * (see alone) the share is set globally, so then no other task may call the BLAS during the lifetime of the object. Every other block
+ * calls the single threaded BLAS that plan has set.
+ * @param n dimension of the block
+ */
+ThreadBudget::ThreadBudget(int n){
+
+   old = 0;
+
+   if(set_local != 0)
+      old = set_local(blas_threads(n));
+   else if(alone(n)){
+
+      old = global;
+
+      global = blas_threads(n);
+
+      set_global(lib,global);
+
+   }
+
+}
+
+/**
+ * Destructor: restore the BLAS threads of the current task
+ */
+ThreadBudget::~ThreadBudget(){
+
+   if(set_local != 0)
+      set_local(old);
+   else if(old != 0){
+
+      global = old;
+
+      set_global(lib,global);
+
+   }
+
+}
+
+/**
+ * Set the total number of threads and detect the BLAS library that is linked in.
+ * @param threads the number of threads, if 0 or smaller the OpenMP default is used
+ */
+void ThreadBudget::init(int threads){
+
+#ifdef _OPENMP
+
+   if(threads > 0)
+      omp_set_num_threads(threads);
+
+   ThreadBudget::threads = omp_get_max_threads();
+
+#else
+
+   ThreadBudget::threads = 1;
+
+#endif
+
+   //the libraries that set the threads per calling thread first
+   set_local = (int (*)(int)) dlsym(RTLD_DEFAULT,"mkl_set_num_threads_local");
+
+   if(set_local != 0)
+      lib = 2;
+   else if(dlsym(RTLD_DEFAULT,"openblas_set_num_threads") != 0){
+
+      lib = 1;
+
+      set_local = (int (*)(int)) dlsym(RTLD_DEFAULT,"openblas_set_num_threads_local");
+
+      if(!concurrent_safe()){
+
+         std::cerr << "ThreadBudget: " << openblas_config() << " is not safe for concurrent calls (0.3.7 or later is), the blocks are separated by one thread" << endl;
+
+#ifdef _OPENMP
+         omp_set_num_threads(1);
+#endif
+
+      }
+
+   }
+   else if(dlsym(RTLD_DEFAULT,"bli_thread_set_num_threads") != 0)
+      lib = 3;
+   else
+      lib = 0;
+
+   //until plan is called the BLAS doesn't compete with tasks, a library that can't be controlled is assumed to be single threaded
+   global = (lib == 0) ? 1 : ThreadBudget::threads;
+
+   set_global(lib,global);
+
+}
+
+/**
+ * Calculate the work of the blocks of a SUP and make the BLAS single threaded outside the blocks that get more threads, see the constructor.
+ * Only the blocks of this MPI rank count, so call it after Distribution::distribute.
+ * @param shape SUP whose blocks are separated concurrently
+ * @param copies the number of SUP's of this shape that are separated concurrently (the batch mode of spin_bp)
+ */
+void ThreadBudget::plan(const SUP &shape,int copies){
+
+   work = 0.0;
+   n_max = 0;
+
+   const BlockMatrix *parts[SepStats::n_part] = {&shape.tpm(0),&shape.tpm(1),0,0,0};
+
+#ifdef __G_CON
+
+   parts[2] = &shape.phm();
+
+#endif
+
+#ifdef __T1_CON
+
+   parts[3] = &shape.dpm();
+
+#endif
+
+#ifdef __T2_CON
+
+   parts[4] = &shape.pphm();
+
+#endif
+
+   for(int k = 0;k < SepStats::n_part;++k){
+
+      if(parts[k] == 0)
+         continue;
+
+      for(int i = 0;i < parts[k]->gnr();++i){
+
+         //only the blocks of this MPI rank compete for the threads, see Distribution
+         if((*parts[k])[i].gremote())
+            continue;
+
+         double n = parts[k]->gdim(i);
+
+         work += copies*n*n*n;
+
+         if(parts[k]->gdim(i) > n_max)
+            n_max = parts[k]->gdim(i);
+
+      }
+
+   }
+
+   ThreadBudget::copies = copies;
+
+   //the BLAS is single threaded in the concurrent tasks, a block that gets more threads sets them itself (see the constructor)
+   global = 1;
+
+   set_global(lib,global);
+
+}
+
+/**
+ * A block runs alone when it gets more than one BLAS thread and the library can only set the threads for the whole program: it is then
+ * separated after the concurrent tasks, while no other task calls the BLAS (see BlockMatrix::sep_pm). In the batch mode (copies > 1)
+ * the instances are always concurrent, so no block runs alone and all of them call the single threaded BLAS.
+ * @param n dimension of a block
+ * @return true if a block of dimension n runs alone
+ */
+bool ThreadBudget::alone(int n){
+
+   return set_local == 0 && lib != 0 && copies == 1 && blas_threads(n) > 1;
+
+}
+
+/**
+ * @return the number of BLAS threads that is set for the whole program: 1 while the blocks are separated concurrently, the share of
+ * a block while it runs alone. Code that calls the BLAS from concurrent tasks of its own (see Matrix::syrk_tiled) runs them one after
+ * the other when this is larger than one.
+ */
+int ThreadBudget::global_threads(){
+
+   return global;
+
+}
+
+/**
+ * @return the total number of threads
+ */
+int ThreadBudget::gthreads(){
+
+   return threads;
+
+}
+
+/**
+ * @param n dimension of a block
+ * @return the number of BLAS threads for a block of dimension n: its share of the work of all the blocks, at least one
+ */
+int ThreadBudget::blas_threads(int n){
+
+   if(work <= 0.0)
+      return threads;
+
+   int t = (int) std::floor(threads * (double)n*n*n / work + 0.5);
+
+   if(t < 1)
+      return 1;
+
+   if(t > threads)
+      return threads;
+
+   return t;
+
+}
+
+/**
+ * @return the name of the BLAS library whose threads are controlled
+ */
+const char *ThreadBudget::blas_name(){
+
+   return lib_name[lib];
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
@@ -0,0 +1,417 @@
+/**
+ * @file bench.cpp
+ * Microbenchmarks for the map and linear algebra kernels of the boundary point method. Every kernel is timed
+ * on random input for a grid of sp dimensions M, the random generator is reseeded for every kernel so that runs are
+ * reproducible. For every kernel the median time, the variance of the timings and the achieved bandwidth (GB/s) or
+ * floating point rate (GFLOP/s) are reported on screen and in a tab separated file for further processing.
+ * The benchmark is compiled with all the conditions active: make bench
+ * @author Brecht Verstichel, Ward Poelmans
+ * @date 19-10-2026
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <getopt.h>
+#include <time.h>
+
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::vector;
+
+#include "include.h"
+
+/**
+ * All the objects the kernels work on, allocated for one value of M.
+ */
+struct Operands{
+
+   Operands(int M,int N) : tpm_i(M,N),tpm_o(M,N),spm(M,N),phm_i(M,N),phm_o(M,N),dpm_i(M,N),dpm_o(M,N),
+      pphm_i(M,N),pphm_o(M,N),sup_i(M,N),sup_o(M,N),mat(0),p(0),m(0) { }
+
+   ~Operands(){
+
+      delete mat;
+      delete p;
+      delete m;
+
+   }
+
+   TPM tpm_i;
+   TPM tpm_o;
+
+   SPM spm;
+
+   PHM phm_i;
+   PHM phm_o;
+
+   DPM dpm_i;
+   DPM dpm_o;
+
+   PPHM pphm_i;
+   PPHM pphm_o;
+
+   SUP sup_i;
+   SUP sup_o;
+
+   //!input and output of the Matrix::sep_pm benchmark, which destroys its input
+   Matrix *mat;
+   Matrix *p;
+   Matrix *m;
+
+};
+
+/**
+ * @return the number of bytes needed to store the BlockMatrix blockmat
+ */
+double size(const BlockMatrix &blockmat){
+
+   double ward = 0.0;
+
+   for(int i = 0;i < blockmat.gnr();++i)
+      ward += 8.0 * blockmat.gdim(i) * blockmat.gdim(i);
+
+   return ward;
+
+}
+
+/**
+ * @return the number of bytes needed to store the SUP sup
+ */
+double size(const SUP &sup){
+
+   double ward = size(sup.tpm(0)) + size(sup.tpm(1));
+
+#ifdef __G_CON
+   ward += size(sup.phm());
+#endif
+
+#ifdef __T1_CON
+   ward += size(sup.dpm());
+#endif
+
+#ifdef __T2_CON
+   ward += size(sup.pphm());
+#endif
+
+   return ward;
+
+}
+
+//the kernels, every kernel has a (not timed) setup, the timed run and a count of bytes and flops
+void run_Q(Operands &o){ o.tpm_o.Q(1,o.tpm_i); }
+void run_S(Operands &o){ o.tpm_o.S(1,o.tpm_i); }
+void run_S_inv(Operands &o){ o.tpm_o.S(-1,o.tpm_i); }
+void run_spm_bar(Operands &o){ o.spm.bar(1.0,o.tpm_i); }
+void run_phm_G(Operands &o){ o.phm_o.G(o.tpm_i); }
+void run_tpm_G(Operands &o){ o.tpm_o.G(o.phm_i); }
+void run_dpm_T(Operands &o){ o.dpm_o.T(o.tpm_i); }
+void run_tpm_bar_dpm(Operands &o){ o.tpm_o.bar(o.dpm_i); }
+void run_pphm_T(Operands &o){ o.pphm_o.T(o.tpm_i); }
+void run_tpm_bar_pphm(Operands &o){ o.tpm_o.bar(o.pphm_i); }
+void run_collaps(Operands &o){ o.tpm_o.collaps(1,o.sup_i); }
+void run_fill(Operands &o){ o.sup_o.fill(o.tpm_i); }
+void run_ddot(Operands &o){ volatile double ward = o.sup_i.ddot(o.sup_o); (void) ward; }
+void run_chain(Operands &o){ o.sup_o.dscal(0.5); o.sup_o.daxpy(2.0,o.sup_i); o.sup_o -= o.sup_i; }
+void run_lincomb(Operands &o){ o.sup_o = 0.5*o.sup_o + 2.0*o.sup_i - o.sup_i; }
+void run_sep_pm(Operands &o){ o.mat->sep_pm(*o.p,*o.m); }
+void run_sep_pm_single(Operands &o){ o.mat->sep_pm(*o.p,*o.m,true); }
+void run_sep_pm_sign(Operands &o){ o.mat->sep_pm_sign(*o.p,*o.m); }
+void run_sep_pm_tiled(Operands &o){ o.mat->sep_pm_tiled(*o.p,*o.m); }
+void run_definite(Operands &o){ volatile int def = o.mat->definite(); (void) def; }
+
+double bytes_tt(const Operands &o){ return 2.0*size(o.tpm_i); }
+double bytes_spm(const Operands &o){ return size(o.tpm_i) + 8.0*o.spm.gn()*o.spm.gn(); }
+double bytes_tph(const Operands &o){ return size(o.tpm_i) + size(o.phm_i); }
+double bytes_tdp(const Operands &o){ return size(o.tpm_i) + size(o.dpm_i); }
+double bytes_tpph(const Operands &o){ return size(o.tpm_i) + size(o.pphm_i); }
+double bytes_sup(const Operands &o){ return size(o.tpm_i) + size(o.sup_i); }
+double bytes_ddot(const Operands &o){ return 2.0*size(o.sup_i); }
+double bytes_lincomb(const Operands &o){ return 3.0*size(o.sup_i); }
+double bytes_sep_pm(const Operands &o){ return 3.0*8.0*o.mat->gn()*o.mat->gn(); }
+
+double flops_none(const Operands &){ return 0.0; }
+double flops_ddot(const Operands &o){ return size(o.sup_i)/4.0; }
+double flops_lincomb(const Operands &o){ return 5.0*size(o.sup_i)/8.0; }
+
+//dsyev with eigenvectors takes about 9 n^3 flops, the construction of the plus and minus part another n^3
+double flops_sep_pm(const Operands &o){ return 10.0 * std::pow((double)o.mat->gn(),3); }
+
+//a Cholesky decomposition takes n^3/3 flops
+double flops_definite(const Operands &o){ return std::pow((double)o.mat->gn(),3)/3.0; }
+
+void setup_none(Operands &){ }
+
+//sep_pm is benchmarked on a random matrix of the dimension of the largest block of the SUP
+void setup_sep_pm(Operands &o){
+
+   if(o.mat == 0){
+
+      int n = o.pphm_i.gdim(0);
+
+      o.mat = new Matrix(n);
+      o.p = new Matrix(n);
+      o.m = new Matrix(n);
+
+   }
+
+   *o.mat = o.pphm_i[0];
+
+}
+
+//the fast path of sep_pm is benchmarked on the same matrix shifted to be positive definite, but not diagonally dominant
+void setup_sep_pm_definite(Operands &o){
+
+   setup_sep_pm(o);
+
+   double shift = std::sqrt(o.mat->ddot(*o.mat));
+
+   for(int i = 0;i < o.mat->gn();++i)
+      (*o.mat)(i,i) += shift;
+
+}
+
+/**
+ * description of a single kernel
+ */
+struct Kernel{
+
+   //!name of the kernel as it appears in the output
+   const char *name;
+
+   //!untimed preparation of the input, called before every timed run
+   void (*setup)(Operands &);
+
+   //!the timed kernel
+   void (*run)(Operands &);
+
+   //!number of bytes the kernel has to stream through memory at least
+   double (*bytes)(const Operands &);
+
+   //!number of floating point operations, zero when this is not meaningful
+   double (*flops)(const Operands &);
+
+};
+
+Kernel kernels[] = {
+
+   {"TPM::Q",setup_none,run_Q,bytes_tt,flops_none},
+   {"TPM::S(1)",setup_none,run_S,bytes_tt,flops_none},
+   {"TPM::S(-1)",setup_none,run_S_inv,bytes_tt,flops_none},
+   {"SPM::bar",setup_none,run_spm_bar,bytes_spm,flops_none},
+   {"PHM::G",setup_none,run_phm_G,bytes_tph,flops_none},
+   {"TPM::G",setup_none,run_tpm_G,bytes_tph,flops_none},
+   {"DPM::T",setup_none,run_dpm_T,bytes_tdp,flops_none},
+   {"TPM::bar(DPM)",setup_none,run_tpm_bar_dpm,bytes_tdp,flops_none},
+   {"PPHM::T",setup_none,run_pphm_T,bytes_tpph,flops_none},
+   {"TPM::bar(PPHM)",setup_none,run_tpm_bar_pphm,bytes_tpph,flops_none},
+   {"TPM::collaps",setup_none,run_collaps,bytes_sup,flops_none},
+   {"SUP::fill",setup_none,run_fill,bytes_sup,flops_none},
+   {"SUP::ddot",setup_none,run_ddot,bytes_ddot,flops_ddot},
+   {"SUP dscal+daxpy+-=",setup_none,run_chain,bytes_lincomb,flops_lincomb},
+   {"SUP LinComb",setup_none,run_lincomb,bytes_lincomb,flops_lincomb},
+   {"Matrix::sep_pm",setup_sep_pm,run_sep_pm,bytes_sep_pm,flops_sep_pm},
+   {"Matrix::sep_pm(single)",setup_sep_pm,run_sep_pm_single,bytes_sep_pm,flops_sep_pm},
+   {"Matrix::sep_pm(sign)",setup_sep_pm,run_sep_pm_sign,bytes_sep_pm,flops_sep_pm},
+   {"Matrix::sep_pm(tiled)",setup_sep_pm,run_sep_pm_tiled,bytes_sep_pm,flops_sep_pm},
+   {"Matrix::definite",setup_sep_pm_definite,run_definite,bytes_sep_pm,flops_definite},
+   {"Matrix::sep_pm(definite)",setup_sep_pm_definite,run_sep_pm,bytes_sep_pm,flops_definite}
+
+};
+
+/**
+ * @return the wall clock time in seconds
+ */
+double wtime(){
+
+   timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+
+   return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+
+}
+
+int main(int argc,char **argv)
+{
+   cout.precision(5);
+
+   // these are the default values
+   int M_start = 8;
+   int M_end = 32;
+   int M_step = 4;
+   int repeat = 11;
+   unsigned int seed = 1234;
+   const char *filter = 0;
+   const char *filename = "bench_output.txt";
+
+   struct option long_options[] =
+   {
+      {"start",  required_argument, 0, 's'},
+      {"end",  required_argument, 0, 'e'},
+      {"step",  required_argument, 0, 'd'},
+      {"repeat",  required_argument, 0, 'r'},
+      {"seed",  required_argument, 0, 'x'},
+      {"kernel",  required_argument, 0, 'k'},
+      {"output",  required_argument, 0, 'o'},
+      {"isa",  required_argument, 0, 'i'},
+      {"help",  no_argument, 0, 'h'},
+      {0, 0, 0, 0}
+   };
+
+   int i,j;
+   while( (j = getopt_long (argc, argv, "hs:e:d:r:x:k:o:i:", long_options, &i)) != -1)
+      switch(j)
+      {
+         case 'h':
+         case '?':
+            cout << "Usage: " << argv[0] << " [OPTIONS]\n"
+               "\n"
+               "    -s, --start=M                Smallest number of sp orbitals (default 8)\n"
+               "    -e, --end=M                  Largest number of sp orbitals (default 32)\n"
+               "    -d, --step=step              Step in the number of sp orbitals (default 4)\n"
+               "    -r, --repeat=repeat          Number of timed runs per kernel (default 11)\n"
+               "    -x, --seed=seed              Seed of the random number generator (default 1234)\n"
+               "    -k, --kernel=name            Only run the kernels whose name contains name\n"
+               "    -o, --output=file            Tab separated output file (default bench_output.txt)\n"
+               "    -i, --isa=name               Instruction set of the map kernels: scalar, avx2, avx512 or auto (default)\n"
+               "    -h, --help                   Display this help\n"
+               "\n";
+            return 0;
+            break;
+         case 's':
+            M_start = atoi(optarg);
+            break;
+         case 'e':
+            M_end = atoi(optarg);
+            break;
+         case 'd':
+            M_step = atoi(optarg);
+            break;
+         case 'r':
+            repeat = atoi(optarg);
+            break;
+         case 'x':
+            seed = atoi(optarg);
+            break;
+         case 'k':
+            filter = optarg;
+            break;
+         case 'o':
+            filename = optarg;
+            break;
+         case 'i':
+            if(!MapStreams::set_isa(optarg))
+            {
+               std::cerr << "Instruction set " << optarg << " is unknown or not supported!" << endl;
+               return -2;
+            }
+            break;
+      }
+
+   if(M_start < 8 || M_start%2 != 0 || M_step <= 0 || M_step%2 != 0 || repeat <= 0){
+
+      std::cerr << "Invalid grid: M has to be even and at least 8, the step has to be even and positive!" << endl;
+      return -1;
+
+   }
+
+   ofstream output(filename);
+   output.precision(10);
+
+   output << "#kernel\tM\tN\trepeat\tmedian(s)\tvariance(s^2)\tmin(s)\tbytes\tGB/s\tflops\tGFLOP/s" << endl;
+
+   int nr_kernels = sizeof(kernels)/sizeof(Kernel);
+
+   vector<double> timing(repeat);
+
+   //the kernels create tasks (see TPM::Q), which are executed by the threads of this region
+   #pragma omp parallel
+   #pragma omp single
+   for(int M = M_start;M <= M_end;M += M_step){
+
+      int N = M/2;
+
+      Operands o(M,N);
+
+      for(int k = 0;k < nr_kernels;++k){
+
+         if(filter && strstr(kernels[k].name,filter) == 0)
+            continue;
+
+         //same random input for every kernel and every run of the program
+         srand(seed);
+
+         o.tpm_i.fill_Random();
+         o.phm_i.fill_Random();
+         o.dpm_i.fill_Random();
+         o.pphm_i.fill_Random();
+
+         o.sup_i.fill_Random();
+         o.sup_o.fill_Random();
+
+         //warm up
+         kernels[k].setup(o);
+         kernels[k].run(o);
+
+         for(int r = 0;r < repeat;++r){
+
+            kernels[k].setup(o);
+
+            double start = wtime();
+
+            kernels[k].run(o);
+
+            timing[r] = wtime() - start;
+
+         }
+
+         double mean = 0.0;
+
+         for(int r = 0;r < repeat;++r)
+            mean += timing[r];
+
+         mean /= repeat;
+
+         double var = 0.0;
+
+         for(int r = 0;r < repeat;++r)
+            var += (timing[r] - mean)*(timing[r] - mean);
+
+         if(repeat > 1)
+            var /= repeat - 1.0;
+
+         std::sort(timing.begin(),timing.end());
+
+         double median = timing[repeat/2];
+
+         if(repeat%2 == 0)
+            median = 0.5 * (timing[repeat/2 - 1] + timing[repeat/2]);
+
+         double bytes = kernels[k].bytes(o);
+         double flops = kernels[k].flops(o);
+
+         cout << kernels[k].name << "\tM=" << M << "\tN=" << N << "\t" << median << " s (+/- " << std::sqrt(var) << ")\t"
+            << 1.0e-9*bytes/median << " GB/s";
+
+         if(flops > 0.0)
+            cout << "\t" << 1.0e-9*flops/median << " GFLOP/s";
+
+         cout << endl;
+
+         output << kernels[k].name << "\t" << M << "\t" << N << "\t" << repeat << "\t" << median << "\t" << var << "\t" << timing[0] << "\t"
+            << bytes << "\t" << 1.0e-9*bytes/median << "\t" << flops << "\t" << 1.0e-9*flops/median << endl;
+
+      }
+
+   }
+
+   return 0;
+
+}
+
+/* vim: set ts=3 sw=3 expandtab :*/
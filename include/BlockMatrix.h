@@ -5,9 +5,12 @@
 #include <cstdlib>
 
 #include "Matrix.h"
+#include "LinComb.h"
 
 using std::ostream;
 
+class LRBlockMatrix;
+
 /**
  * @author Brecht Verstichel
  * @date 15-04-2010\n\n
@@ -37,6 +40,9 @@ class BlockMatrix{
       //copy constructor
       BlockMatrix(const BlockMatrix &);
 
+      //move constructor
+      BlockMatrix(BlockMatrix &&);
+
       //destructor
       virtual ~BlockMatrix();
 
@@ -49,6 +55,17 @@ class BlockMatrix{
       //overload equality operator
       BlockMatrix &operator=(const BlockMatrix &);
 
+      //move assignment
+      BlockMatrix &operator=(BlockMatrix &&);
+
+      //evaluate a linear combination
+      template<int K>
+      BlockMatrix &operator=(const LinComb<BlockMatrix,K> &lc){ return lincomb(K,lc.gcoef(),lc.gterm()); }
+
+      BlockMatrix &lincomb(int K,const double *coef,const BlockMatrix * const *term);
+
+      void swap(BlockMatrix &);
+
       BlockMatrix &operator=(double );
 
       //overload += operator
@@ -96,7 +113,15 @@ class BlockMatrix{
 
       void out(const char *) const;
 
-      void sep_pm(BlockMatrix &p,BlockMatrix &m);
+      void sep_pm(BlockMatrix &p,BlockMatrix &m,bool single = false,double scale = 1.0,LRBlockMatrix *m_f = 0,long *n_def = 0,bool alone = false);
+
+      int n_alone() const;
+
+      double update(BlockMatrix &);
+
+      void prefetch() const;
+
+      void release() const;
 
    private:
 
@@ -0,0 +1,146 @@
+#ifndef BOUNDARYPOINT_H
+#define BOUNDARYPOINT_H
+
+#include <iostream>
+
+#include "TPM.h"
+#include "SUP.h"
+#include "LRSUP.h"
+#include "SepStats.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * The state of one boundary point solve: the dual Z, W (which holds the Lagrange multiplier V after a projection), the primal X
+ * and the collapsed TPM's and parameters of the method. One call to outer() does one outer iteration: the inner iterations with
+ * the projections, the primal update and the update of sigma. spin_bp runs one solve at a time, or in batch mode many independent
+ * solves concurrently, one outer iteration of every solve per sweep.
+ */
+class BoundaryPoint{
+
+   public:
+
+      //constructor
+      BoundaryPoint(const TPM &ham,double lowrank,double single);
+
+      //no copies: the SUP's are large
+      BoundaryPoint(const BoundaryPoint &) = delete;
+
+      BoundaryPoint &operator=(const BoundaryPoint &) = delete;
+
+      //destructor
+      virtual ~BoundaryPoint();
+
+      void outer();
+
+      bool converged() const;
+
+      bool diverged() const;
+
+      double energy() const;
+
+      double pd_gap() const;
+
+      double gP_conv() const;
+
+      double gD_conv() const;
+
+      double gsigma() const;
+
+      double gconvergence() const;
+
+      int giter() const;
+
+      bool gsingle() const;
+
+      SUP &gZ();
+
+      SUP &gW();
+
+      const LRSUP &gX() const;
+
+      SepStats &gstats();
+
+   private:
+
+      //!dimension of sp space
+      int M;
+
+      //!nr of particles
+      int N;
+
+      //!the traceless hamiltonian
+      TPM ham;
+
+      //!the hamiltonian, for the energy
+      TPM ham_copy;
+
+      //!dual
+      SUP Z;
+
+      //!just dubya, after the projection it contains the Lagrange multiplier V = -sigma W_-: no separate SUP is stored for V
+      SUP W;
+
+      //!primal, initialized to zero: blocks with low rank are stored as their factor
+      LRSUP X;
+
+      //!the factors of V calculated in the projection, taken over by X in the primal update
+      LRSUP V_f;
+
+      //!how often the blocks of W are definite in the projection
+      SepStats stats;
+
+      //!u^0 = fill(u) is never stored: all that is needed is u itself, which is a multiple of the unit TPM
+      TPM u;
+
+      //!the gamma's of the last projection
+      TPM hulp;
+
+      //!collaps(fill(u)) = S(u), projected on traceless space
+      TPM u_0_c;
+
+      //!the collapsed primal matrix
+      TPM X_c;
+
+      //!constant part of the affine projection during an outer iteration
+      TPM rhs;
+
+      //!the collapsed V of the last inner iteration
+      TPM v;
+
+      //!penalty parameter
+      double sigma;
+
+      //!convergence criterion for the residuals and the gap
+      double tolerance;
+
+      //!mazziotti uses 1.6 for this
+      double mazzy;
+
+      //!maximal number of inner iterations minus one
+      int max_iter;
+
+      //!the dual and primal residual and the gap
+      double D_conv,P_conv,convergence;
+
+      //!the number of outer iterations
+      int iter_primal;
+
+      //!single precision projections as long as one of the residuals is larger than this
+      double single;
+
+      //!precision schedule of the projections
+      bool use_single;
+
+      //!the smallest value of the larger residual of the single precision projections so far
+      double single_min;
+
+      //!number of outer iterations since single_min decreased
+      int single_stall;
+
+      //!switch to double precision when the residuals have not decreased for this many outer iterations
+      int max_stall;
+
+};
+
+#endif
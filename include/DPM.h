@@ -8,6 +8,8 @@ using std::ostream;
 #include "BlockMatrix.h"
 #include "TPM.h"
 
+class SPM;
+
 /**
  * @author Brecht Verstichel
  * @date 23-02-2010\n\n
@@ -35,13 +37,23 @@ class DPM : public BlockMatrix {
       //copy constructor
       DPM(const DPM &);
 
+      //move constructor
+      DPM(DPM &&);
+
       //destructor
       virtual ~DPM();
 
+      static int block_dim(int M,int i);
+
       void construct_lists();
 
       using BlockMatrix::operator=;
 
+      DPM &operator=(const DPM &) = default;
+
+      //move assignment
+      DPM &operator=(DPM &&);
+
       using BlockMatrix::operator();
 
       //easy to access the numbers, in sp mode
@@ -58,6 +70,9 @@ class DPM : public BlockMatrix {
       //generalized T1 map
       void T(double,double,double,const TPM &);
 
+      //generalized T1 map with given np and sp part
+      void T(double,double,const SPM &,const TPM &);
+
       //maak een DPM van een TPM via de T1 conditie
       void T(const TPM &);
 
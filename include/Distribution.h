@@ -0,0 +1,63 @@
+#ifndef DISTRIBUTION_H
+#define DISTRIBUTION_H
+
+#include <iostream>
+#include <vector>
+
+using std::ostream;
+
+#include "SUP.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * Distribution of the blocks of the SUP's of the solver over MPI ranks, for problems that don't fit on one node. Every spinblock of every
+ * condition is owned by one rank, the blocks are assigned largest first to the rank with the least n^3 work so far. On the other ranks
+ * the block is remote (see Matrix::set_remote): it is zero and takes no memory. Every rank fills, separates and collapses only its own
+ * blocks; because the down maps are linear, the collapsed TPM's of the ranks add up to the full one. So only TPM's and scalars are
+ * communicated: sum() reduces them on rank 0 and broadcasts the result, so that all ranks have the same numbers and run the
+ * same iterations. The primal blocks of the other ranks are never updated and take no memory either.\n\n
+ * Compile with make ... MPI=1 (which uses mpicxx and defines __MPI) and run with mpirun -np ranks ./spin_bp. Without __MPI there is
+ * one rank and all the functions do nothing.
+ */
+class Distribution{
+
+   public:
+
+      static void init(int *argc,char ***argv);
+
+      static void finalize();
+
+      static int grank();
+
+      static int gsize();
+
+      static void distribute(SUP &,SUP &);
+
+      static void report(ostream &);
+
+      static double sum(double);
+
+      static long sum(long);
+
+      static void sum(long *,int n);
+
+      static void sum(BlockMatrix &);
+
+   private:
+
+      //!the rank of this process
+      static int rank;
+
+      //!the number of ranks
+      static int size;
+
+      //!the n^3 work of the blocks of every rank
+      static std::vector<double> load;
+
+      //!the number of blocks of every rank
+      static std::vector<int> n_blocks;
+
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef DOWNMAPS_H
+#define DOWNMAPS_H
+
+#include <iostream>
+
+#include "TPM.h"
+#include "SPM.h"
+#include "PHM.h"
+#include "DPM.h"
+#include "PPHM.h"
+#include "SUP.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * The down maps of all conditions are sums of a tp, np, sp and ph part (see TPM::collaps). This class holds these parts for every condition
+ * separately, so that the down maps of the different blocks of a SUP are independent and can be calculated in any order, or at the
+ * same time in different tasks. sum() then adds them in a fixed order and constructs the collapsed TPM in one pass, so the result
+ * doesn't depend on the order in which the parts were calculated.
+ */
+class DownMaps{
+
+   public:
+
+      //constructor
+      DownMaps(int M,int N);
+
+      //no copies: the parts can be large
+      DownMaps(const DownMaps &) = delete;
+
+      DownMaps &operator=(const DownMaps &) = delete;
+
+      //destructor
+      virtual ~DownMaps();
+
+      void P(const TPM &);
+
+      void Q(const TPM &);
+
+#ifdef __G_CON
+
+      void G(const PHM &);
+
+#endif
+
+#ifdef __T1_CON
+
+      void T1(const DPM &);
+
+#endif
+
+#ifdef __T2_CON
+
+      void T2(const PPHM &);
+
+#endif
+
+      void sum(TPM &) const;
+
+   private:
+
+      //!dimension of sp space
+      int M;
+
+      //!nr of particles
+      int N;
+
+      //!the P block, only referenced
+      const TPM *tpm_P;
+
+      //!the Q block, only referenced: it is its own tp part
+      const TPM *tpm_Q;
+
+      //!sp part of the Q map
+      SPM *spm_Q;
+
+      //!np part of the Q map
+      double ward_Q;
+
+#ifdef __G_CON
+
+      //!the G block, only referenced: it is its own ph part
+      const PHM *phm_G;
+
+      //!sp part of the G map
+      SPM *spm_G;
+
+#endif
+
+#ifdef __T1_CON
+
+      //!tp part of the T1 map
+      TPM *tpm_T1;
+
+      //!sp part of the T1 map
+      SPM *spm_T1;
+
+      //!np part of the T1 map
+      double ward_T1;
+
+#endif
+
+#ifdef __T2_CON
+
+      //!tp part of the T2 map
+      TPM *tpm_T2;
+
+      //!sp part of the T2 map
+      SPM *spm_T2;
+
+      //!ph part of the T2 map
+      PHM *phm_T2;
+
+#endif
+
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include <iostream>
+
+using std::ostream;
+
+#include "SUP.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * This class estimates the memory use and the time per iteration of the boundary point method for a given M, N and the active conditions,
+ * without allocating the problem: the block dimensions are taken from the static block_dim functions of TPM, PHM, DPM and PPHM.
+ * The time per iteration is calibrated with a short benchmark of the eigendecomposition and of the maps on small matrices.
+ */
+class Estimate{
+
+   /**
+    * Output stream operator overloaded: prints the block dimensions, the memory use and, if calibrated, the time estimate.
+    * @param output The stream to which you are writing (e.g. cout)
+    * @param est_p the Estimate you want to print
+    */
+   friend ostream &operator<<(ostream &output,const Estimate &est_p);
+
+   public:
+
+      //!maximal number of blocks: 2 for every one of the five parts P, Q, G, T1 and T2
+      static const int max_blocks = 10;
+
+      //constructor
+      Estimate(int M,int N,bool single,int ooc_dim);
+
+      long sup_bytes() const;
+
+      long scratch_bytes() const;
+
+      long temp_bytes() const;
+
+      long peak_bytes() const;
+
+      long disk_bytes() const;
+
+      double flops() const;
+
+      void calibrate();
+
+      double time_per_iteration() const;
+
+   private:
+
+      void add(const char *name,int i,int dim);
+
+      //!dimension of sp space
+      int M;
+
+      //!nr of particles
+      int N;
+
+      //!single precision projections
+      bool single;
+
+      //!blocks with at least this dimension are out-of-core, 0 means none
+      int ooc_dim;
+
+      //!nr of blocks in a SUP
+      int nr;
+
+      //!names of the parts the blocks belong to
+      const char *name[max_blocks];
+
+      //!index of the block in its part
+      int index[max_blocks];
+
+      //!dimension of the blocks
+      int dim[max_blocks];
+
+      //!flop rate of the eigendecomposition in sep_pm, 0 if not calibrated
+      double eig_rate;
+
+      //!number of SUP elements per second for a fill and a collaps, 0 if not calibrated
+      double map_rate;
+
+};
+
+#endif
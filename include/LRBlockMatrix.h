@@ -0,0 +1,61 @@
+#ifndef LRBLOCKMATRIX_H
+#define LRBLOCKMATRIX_H
+
+#include <iostream>
+#include <cstdlib>
+
+#include "BlockMatrix.h"
+#include "LRMatrix.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * This is a class for block matrices with LRMatrix blocks: every block is kept in low rank factored form as long as its rank
+ * is smaller than a fixed fraction of its dimension. The block structure and the degeneracies are copied from a BlockMatrix.
+ */
+class LRBlockMatrix{
+
+   public:
+
+      //constructor
+      LRBlockMatrix(const BlockMatrix &,double fraction);
+
+      //copy constructor
+      LRBlockMatrix(const LRBlockMatrix &);
+
+      //destructor
+      virtual ~LRBlockMatrix();
+
+      //overload equality operator
+      LRBlockMatrix &operator=(const LRBlockMatrix &);
+
+      LRMatrix &operator[](int);
+
+      const LRMatrix &operator[](int) const;
+
+      int gnr() const;
+
+      int gdeg(int) const;
+
+      void add_to(double alpha,BlockMatrix &) const;
+
+      double ddot(const BlockMatrix &) const;
+
+      double update(BlockMatrix &,LRBlockMatrix &);
+
+      long memory() const;
+
+   private:
+
+      //!pointer to LRMatrix objects, will contain the different blocks
+      LRMatrix **blocks;
+
+      //!nr of blocks
+      int nr;
+
+      //!degeneracy of the blocks
+      int *degen;
+
+};
+
+#endif
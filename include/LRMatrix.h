@@ -0,0 +1,75 @@
+#ifndef LRMATRIX_H
+#define LRMATRIX_H
+
+#include <iostream>
+#include <cstdlib>
+
+#include "Matrix.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * This is a class for positive semidefinite symmetric matrices that are stored in low rank factored form F F^T, with F an n x r matrix,
+ * as long as the rank r is smaller than a maximal rank r_max, and as a dense Matrix otherwise. It is used for the blocks of the primal
+ * matrix in the boundary point method, which near convergence has a rank complementary to that of the dual matrix, so that the large
+ * blocks often have a low rank. The factor is taken directly from the eigenvectors that Matrix::sep_pm calculates.
+ * An LRMatrix can also be used as storage for the factor only (without dense fallback): then r = -1 means that no factor is available.
+ */
+class LRMatrix{
+
+   public:
+
+      //constructor
+      LRMatrix(int n,int r_max);
+
+      //copy constructor
+      LRMatrix(const LRMatrix &);
+
+      //destructor
+      virtual ~LRMatrix();
+
+      //overload equality operator
+      LRMatrix &operator=(const LRMatrix &);
+
+      int gn() const;
+
+      int gr() const;
+
+      int gr_max() const;
+
+      bool factored() const;
+
+      double *set_rank(int r);
+
+      void expand(Matrix &) const;
+
+      void add_to(double alpha,Matrix &) const;
+
+      double ddot(const Matrix &) const;
+
+      double update(Matrix &,LRMatrix &);
+
+      long memory() const;
+
+      int gnode() const;
+
+   private:
+
+      //!dimension of the matrix
+      int n;
+
+      //!rank of the factor, -1 if the matrix is not stored in factored form
+      int r;
+
+      //!maximal rank for which the factored form is kept
+      int r_max;
+
+      //!the factor, n x r in column major order
+      double *F;
+
+      //!the dense matrix when the rank is too large, 0 otherwise
+      Matrix *dense;
+
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef LRSUP_H
+#define LRSUP_H
+
+#include <iostream>
+#include <fstream>
+
+using std::ostream;
+
+#include "LRBlockMatrix.h"
+#include "SUP.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * This class, LRSUP, has the block structure of a SUP, but every block is an LRMatrix. It is used to store the primal matrix
+ * of the boundary point method: near convergence X and Z are complementary, so the blocks of X where Z has a large rank are
+ * stored as their factor. It is also used to pass the factors of the negative part from SUP::proj_U_sep to the primal update.
+ */
+class LRSUP{
+
+   public:
+
+   //constructor
+   LRSUP(const SUP &,double fraction);
+
+   //copy constructor
+   LRSUP(const LRSUP &);
+
+   //destructor
+   ~LRSUP();
+
+   //overload equality operator
+   LRSUP &operator=(const LRSUP &);
+
+   LRBlockMatrix &tp(int);
+
+   const LRBlockMatrix &tp(int) const;
+
+#ifdef __G_CON
+
+   LRBlockMatrix &ph();
+
+   const LRBlockMatrix &ph() const;
+
+#endif
+
+#ifdef __T1_CON
+
+   LRBlockMatrix &dp();
+
+   const LRBlockMatrix &dp() const;
+
+#endif
+
+#ifdef __T2_CON
+
+   LRBlockMatrix &pph();
+
+   const LRBlockMatrix &pph() const;
+
+#endif
+
+   void add_to(double alpha,SUP &) const;
+
+   double ddot(const SUP &) const;
+
+   double update(SUP &,LRSUP &);
+
+   long memory() const;
+
+   private:
+
+   //!double pointer to LRBlockMatrix objects, the P and Q block
+   LRBlockMatrix **lr_tp;
+
+#ifdef __G_CON
+
+   //!the G block
+   LRBlockMatrix *lr_ph;
+
+#endif
+
+#ifdef __T1_CON
+
+   //!the T1 block
+   LRBlockMatrix *lr_dp;
+
+#endif
+
+#ifdef __T2_CON
+
+   //!the T2 block
+   LRBlockMatrix *lr_pph;
+
+#endif
+
+};
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef LINCOMB_H
+#define LINCOMB_H
+
+#include <iostream>
+
+class Matrix;
+class BlockMatrix;
+class SUP;
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * This is a template class for lazily evaluated linear combinations c_0 T_0 + c_1 T_1 + ... + c_K-1 T_K-1 of objects of type T (Matrix,
+ * BlockMatrix or SUP, the classes derived from these are combined as their mother class). The number of terms K is part of the type:
+ * the operators *, + and - give a combination whose K is the sum of that of their operands, so the length of an expression like\n\n
+ * W = Z - u_0 + alpha * X;\n\n
+ * is known at compile time and there is no limit on it. The combination only stores the coefficients and pointers to the terms, nothing
+ * is calculated until it is assigned to an object of type T. The assignment evaluates the whole combination block by block, see
+ * Matrix::lincomb. The terms are referenced, not copied, so a LinComb must be assigned in the same expression in which it is built.
+ * The target may appear as one of the terms.
+ */
+template<class T,int K>
+class LinComb{
+
+   public:
+
+      //!the type of the terms
+      typedef T leaf;
+
+      //one term: alpha * t
+      LinComb(double alpha,const T &t);
+
+      //the terms of lc_l followed by those of lc_r multiplied with alpha
+      template<int K_l>
+      LinComb(const LinComb<T,K_l> &lc_l,double alpha,const LinComb<T,K - K_l> &lc_r);
+
+      LinComb &scale(double alpha);
+
+      const double *gcoef() const;
+
+      const T * const *gterm() const;
+
+   private:
+
+      //!the coefficients of the terms
+      double coef[K];
+
+      //!pointers to the terms
+      const T *term[K];
+
+};
+
+/**
+ * constructor of a combination with one term
+ * @param alpha the coefficient of the term
+ * @param t the term
+ */
+template<class T,int K>
+LinComb<T,K>::LinComb(double alpha,const T &t){
+
+   static_assert(K == 1,"a single term is a combination of length 1");
+
+   coef[0] = alpha;
+   term[0] = &t;
+
+}
+
+/**
+ * constructor of the combination lc_l + alpha lc_r
+ * @param lc_l the first terms
+ * @param alpha the factor for the terms of lc_r
+ * @param lc_r the last terms
+ */
+template<class T,int K>
+template<int K_l>
+LinComb<T,K>::LinComb(const LinComb<T,K_l> &lc_l,double alpha,const LinComb<T,K - K_l> &lc_r){
+
+   for(int i = 0;i < K_l;++i){
+
+      coef[i] = lc_l.gcoef()[i];
+      term[i] = lc_l.gterm()[i];
+
+   }
+
+   for(int i = K_l;i < K;++i){
+
+      coef[i] = alpha * lc_r.gcoef()[i - K_l];
+      term[i] = lc_r.gterm()[i - K_l];
+
+   }
+
+}
+
+/**
+ * multiply the combination with alpha
+ * @param alpha the factor
+ * @return the combination itself
+ */
+template<class T,int K>
+LinComb<T,K> &LinComb<T,K>::scale(double alpha){
+
+   for(int i = 0;i < K;++i)
+      coef[i] *= alpha;
+
+   return *this;
+
+}
+
+/**
+ * @return the K coefficients
+ */
+template<class T,int K>
+const double *LinComb<T,K>::gcoef() const{
+
+   return coef;
+
+}
+
+/**
+ * @return pointers to the K terms
+ */
+template<class T,int K>
+const T * const *LinComb<T,K>::gterm() const{
+
+   return term;
+
+}
+
+/**
+ * @return alpha times the combination lc
+ */
+template<class T,int K>
+LinComb<T,K> operator*(double alpha,LinComb<T,K> lc){
+
+   return lc.scale(alpha);
+
+}
+
+/**
+ * @return the sum of two combinations
+ */
+template<class T,int K_l,int K_r>
+LinComb<T,K_l + K_r> operator+(const LinComb<T,K_l> &lc_l,const LinComb<T,K_r> &lc_r){
+
+   return LinComb<T,K_l + K_r>(lc_l,1.0,lc_r);
+
+}
+
+/**
+ * @return the difference of two combinations
+ */
+template<class T,int K_l,int K_r>
+LinComb<T,K_l + K_r> operator-(const LinComb<T,K_l> &lc_l,const LinComb<T,K_r> &lc_r){
+
+   return LinComb<T,K_l + K_r>(lc_l,-1.0,lc_r);
+
+}
+
+/**
+ * @return the combination lc with the term t added
+ */
+template<class T,int K>
+LinComb<T,K + 1> operator+(const LinComb<T,K> &lc,const typename LinComb<T,K>::leaf &t){
+
+   return LinComb<T,K + 1>(lc,1.0,LinComb<T,1>(1.0,t));
+
+}
+
+/**
+ * @return the combination lc with the term t subtracted
+ */
+template<class T,int K>
+LinComb<T,K + 1> operator-(const LinComb<T,K> &lc,const typename LinComb<T,K>::leaf &t){
+
+   return LinComb<T,K + 1>(lc,-1.0,LinComb<T,1>(1.0,t));
+
+}
+
+/**
+ * @return the combination lc added to the term t
+ */
+template<class T,int K>
+LinComb<T,K + 1> operator+(const typename LinComb<T,K>::leaf &t,const LinComb<T,K> &lc){
+
+   return LinComb<T,K + 1>(LinComb<T,1>(1.0,t),1.0,lc);
+
+}
+
+/**
+ * @return the combination lc subtracted from the term t
+ */
+template<class T,int K>
+LinComb<T,K + 1> operator-(const typename LinComb<T,K>::leaf &t,const LinComb<T,K> &lc){
+
+   return LinComb<T,K + 1>(LinComb<T,1>(1.0,t),-1.0,lc);
+
+}
+
+//the combinations of the leaf types themselves
+inline LinComb<Matrix,1> operator*(double alpha,const Matrix &t){ return LinComb<Matrix,1>(alpha,t); }
+inline LinComb<Matrix,2> operator+(const Matrix &t_l,const Matrix &t_r){ return LinComb<Matrix,1>(1.0,t_l) + t_r; }
+inline LinComb<Matrix,2> operator-(const Matrix &t_l,const Matrix &t_r){ return LinComb<Matrix,1>(1.0,t_l) - t_r; }
+
+inline LinComb<BlockMatrix,1> operator*(double alpha,const BlockMatrix &t){ return LinComb<BlockMatrix,1>(alpha,t); }
+inline LinComb<BlockMatrix,2> operator+(const BlockMatrix &t_l,const BlockMatrix &t_r){ return LinComb<BlockMatrix,1>(1.0,t_l) + t_r; }
+inline LinComb<BlockMatrix,2> operator-(const BlockMatrix &t_l,const BlockMatrix &t_r){ return LinComb<BlockMatrix,1>(1.0,t_l) - t_r; }
+
+inline LinComb<SUP,1> operator*(double alpha,const SUP &t){ return LinComb<SUP,1>(alpha,t); }
+inline LinComb<SUP,2> operator+(const SUP &t_l,const SUP &t_r){ return LinComb<SUP,1>(1.0,t_l) + t_r; }
+inline LinComb<SUP,2> operator-(const SUP &t_l,const SUP &t_r){ return LinComb<SUP,1>(1.0,t_l) - t_r; }
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef MAPSTREAMS_H
+#define MAPSTREAMS_H
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+
+using std::vector;
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * Vector versions (AVX2 and AVX-512) of the map kernels TPM::Q, PHM::G, TPM::G and SPM::bar(TPM). The scalar kernels look up sp indices
+ * in the lists of TPM and PHM and test them for every element, which the compiler can't vectorize. Here the lookups and the tests are done
+ * once: for every element of the upper triangle of a block the streams contain the indices of the input elements it needs (which are
+ * gathered) and the coefficients of the terms, zero for a term whose condition is false. The terms are added in the same order as in
+ * the scalar kernels and a coefficient that is zero or one doesn't change a term, so the results are the same as those of the scalar kernels.
+ * The elements are stored column by column, with every column padded to a multiple of 8, so the output of a column is stored contiguously.
+ * The instruction set is chosen at runtime: the widest that the processor supports, unless it is set with set_isa. The streams only depend
+ * on M, they are constructed the first time they are needed and kept until the end of the program. With set_cache they are stored in a
+ * file per M, which later processes map read-only instead of constructing the streams again: processes on the same node share the pages.
+ */
+class MapStreams{
+
+   public:
+
+      //constructor
+      MapStreams(int M);
+
+      //no copies
+      MapStreams(const MapStreams &) = delete;
+
+      MapStreams &operator=(const MapStreams &) = delete;
+
+      //destructor
+      virtual ~MapStreams();
+
+      static const MapStreams *get(int M);
+
+      static bool set_isa(const char *name);
+
+      static const char *isa_name();
+
+      static void set_cache(const char *dir);
+
+      void Q(int S,double A,double ward,const double *spm,const double *tpm_d,double *out,int node) const;
+
+      void G(int S,const double *spm,const double * const *tpm,double *out,int node) const;
+
+      void G_down(int S,double c_0,double c_1,const double *spm,const double * const *phm,double *out) const;
+
+      void bar(double scale,const double * const *tpm,double *out) const;
+
+   private:
+
+      /**
+       * The streams of one map on one block: per column the offset of its elements, for every element the indices of the input elements
+       * and the coefficients of the terms.
+       */
+      struct Stream{
+
+         //!dimension of the output block
+         int n;
+
+         //!offset of the elements of column j, the column has n_pad[j] places
+         int *col;
+
+         //!number of places of column j, a multiple of 8
+         int *n_pad;
+
+         //!the indices of the input elements, 0 for the streams that are not used
+         int *k[8];
+
+         //!the coefficients
+         double *c[8];
+
+         //!number of places of every stream
+         int size;
+
+         //!number of index and coefficient streams that are used
+         int n_k,n_c;
+
+         //!true if the arrays point into the cache file
+         bool mapped;
+
+         void init(int n,int n_k,int n_c,int per_element);
+
+         ~Stream();
+
+      };
+
+      static int detect();
+
+      Stream &stream(int i);
+
+      size_t image(char *base,bool save);
+
+      std::string cache_file() const;
+
+      bool load();
+
+      void save();
+
+      void Q_avx2(int S,double A,double ward,const double *spm,const double *tpm_d,double *out,int node) const;
+
+      void Q_avx512(int S,double A,double ward,const double *spm,const double *tpm_d,double *out,int node) const;
+
+      void G_avx2(int S,const double *spm,const double * const *tpm,double *out,int node) const;
+
+      void G_avx512(int S,const double *spm,const double * const *tpm,double *out,int node) const;
+
+      void G_down_avx2(int S,double c_0,double c_1,const double *spm,const double * const *phm,double *out) const;
+
+      void G_down_avx512(int S,double c_0,double c_1,const double *spm,const double * const *phm,double *out) const;
+
+      void bar_avx2(double scale,const double * const *tpm,double *out) const;
+
+      void bar_avx512(double scale,const double * const *tpm,double *out) const;
+
+      //!dimension of the sp space
+      int M;
+
+      //!the streams of TPM::Q, per spin block
+      Stream q[2];
+
+      //!the streams of PHM::G, per spin block
+      Stream g[2];
+
+      //!the streams of TPM::G, per spin block
+      Stream g_down[2];
+
+      //!the streams of SPM::bar(TPM)
+      Stream b;
+
+      //!the mapping of the cache file, 0 if the streams were constructed
+      char *map;
+
+      //!size of the mapping
+      size_t map_bytes;
+
+      //!instruction set: 0 scalar, 1 AVX2, 2 AVX-512, -1 not yet determined
+      static int isa;
+
+      //!directory of the cache files, empty for no cache
+      static std::string cache_dir;
+
+      //!the streams that have been constructed, indexed by M
+      static vector< std::unique_ptr<MapStreams> > streams;
+
+};
+
+#endif
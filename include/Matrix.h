@@ -3,10 +3,15 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <string>
 
 using std::ostream;
 
 class Vector;
+class LRMatrix;
+
+template<class T,int K>
+class LinComb;
 
 /**
  * @author Brecht Verstichel
@@ -28,14 +33,23 @@ class Matrix{
     */
    friend ostream &operator<<(ostream &output,const Matrix &matrix_p);
 
+   //!the low rank storage reads and writes the elements directly with blas
+   friend class LRMatrix;
+
+   //!the NUMA report looks up the pages of the elements
+   friend class Numa;
+
    public:
 
       //constructor
-      Matrix(int n);
+      Matrix(int n,bool scratch = false);
 
       //copy constructor
       Matrix(const Matrix &);
 
+      //move constructor
+      Matrix(Matrix &&);
+
       //construct with filename
       Matrix(const char *filename);
 
@@ -45,6 +59,17 @@ class Matrix{
       //overload equality operator
       Matrix &operator=(const Matrix &);
 
+      //move assignment
+      Matrix &operator=(Matrix &&);
+
+      //evaluate a linear combination
+      template<int K>
+      Matrix &operator=(const LinComb<Matrix,K> &lc){ return lincomb(K,lc.gcoef(),lc.gterm()); }
+
+      Matrix &lincomb(int K,const double *coef,const Matrix * const *term);
+
+      void swap(Matrix &);
+
       Matrix &operator=(double );
 
       //overload += operator
@@ -68,6 +93,9 @@ class Matrix{
       //get the pointer to the matrix
       double **gMatrix();
 
+      //read only pointer to the matrix
+      const double * const *gMatrix() const;
+
       int gn() const;
 
       double trace() const;
@@ -91,10 +119,65 @@ class Matrix{
 
       void out(const char*) const;
 
-      void sep_pm(Matrix &,Matrix &);
+      int definite() const;
+
+      int sep_pm(Matrix &,Matrix &,bool single = false,double scale = 1.0,LRMatrix *m_f = 0);
+
+      void sep_pm_single(Matrix &,Matrix &,double scale = 1.0,LRMatrix *m_f = 0);
+
+      void sep_pm_sign(Matrix &,Matrix &,double scale = 1.0);
+
+      void sep_pm_tiled(Matrix &,Matrix &,double scale = 1.0,LRMatrix *m_f = 0);
+
+      double update(Matrix &);
+
+      static void set_sign_dim(int);
+
+      static void set_eig_dim(int);
+
+      static void set_mmap(int dim,const char *dir);
+
+      void prefetch() const;
+
+      void release() const;
+
+      void bind(int node);
+
+      int gnode() const;
+
+      void set_remote();
+
+      bool gremote() const;
 
    private:
 
+      //!blocks with dimension larger than or equal to sign_dim are projected without eigensolver in sep_pm, 0 means never
+      static int sign_dim;
+
+      //!blocks with dimension larger than or equal to eig_dim are diagonalized with sep_pm_tiled in sep_pm, 0 means never
+      static int eig_dim;
+
+      static void syrk_tiled(int k,double alpha,double *F,Matrix &C);
+
+      static double *allocate(int n,bool &mapped,bool scratch = false);
+
+      static void deallocate(double *,int n,bool mapped);
+
+      //!matrices with dimension larger than or equal to mmap_dim are stored in a memory mapped file, 0 means never
+      static int mmap_dim;
+
+      //!directory for the memory mapped files
+      static std::string mmap_dir;
+
+      //!true if the elements are stored in a memory mapped file
+      bool mapped;
+
+      //!the NUMA node to which the elements are bound, -1 if they are not bound, -2 if they are interleaved over all nodes (see Numa)
+      int node;
+
+      //!true if the matrix is a block of another MPI rank: it is always zero and takes no memory (see Distribution)
+      bool remote;
+
       //!double pointer of doubles, contains the numbers, the matrix
       double **matrix;
 
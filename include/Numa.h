@@ -0,0 +1,68 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+using std::ostream;
+using std::vector;
+
+#include "SUP.h"
+#include "LRSUP.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * NUMA placement of the blocks of the SUP's of the solver. Without placement all the blocks are first touched by the main thread and end up
+ * on its node, so on a machine with more sockets the tasks on the other sockets read all their data over the interconnect and only one memory
+ * controller is used. place() distributes the blocks over the nodes: blocks that are diagonalized with more BLAS threads than one node has
+ * (see ThreadBudget) are interleaved over all nodes, the others are bound to the node with the least work so far, largest first.
+ * The worker threads are spread over the sockets by the parallel region of the solver (proc_bind(spread)). The tasks that work on the blocks
+ * (the fill, sep_pm and the down maps) are created with run(), which executes them on the threads of the node of their block as long as
+ * these have work, so that an OpenMP task isn't simply picked up by whichever thread is idle.
+ * The Linux system calls are used directly, so libnuma is not needed. On a machine with one node nothing is moved.
+ */
+class Numa{
+
+   public:
+
+      static int nodes();
+
+      static void bind(void *ptr,size_t bytes,int node);
+
+      static void place(SUP &,SUP &);
+
+      static void report(ostream &,const SUP &);
+
+      static void report_threads(ostream &);
+
+      static int check(ostream &,const SUP &Z,const SUP &W,const LRSUP &X);
+
+      static void run(int count,const int *node,const std::function<void(int)> &work);
+
+      static void run(int count,int node,const std::function<void(int)> &work);
+
+      static int current();
+
+   private:
+
+      static void pages(const Matrix &,long *count);
+
+      //!number of nodes, 0 if not yet determined
+      static int n_nodes;
+
+      //!the node of every block of W chosen by place(), in the order of the parts, empty if nothing was placed
+      static vector<int> placed;
+
+      //!number of tasks of run() that were executed on the node of their block
+      static std::atomic<long> n_local;
+
+      //!number of tasks of run() that were executed on another node, because the threads of their own node were busy
+      static std::atomic<long> n_remote;
+
+};
+
+#endif
@@ -7,6 +7,8 @@ using std::ostream;
 
 #include "BlockMatrix.h"
 #include "TPM.h"
+
+class SPM;
 #include "PPHM.h"
 
 /**
@@ -28,6 +30,9 @@ class PHM : public BlockMatrix {
     */
    friend ostream &operator<<(ostream &output,const PHM &phm_p);
 
+   //the vector kernels use the lists
+   friend class MapStreams;
+
    public:
       
       //constructor
@@ -36,13 +41,23 @@ class PHM : public BlockMatrix {
       //copy constructor
       PHM(const PHM &);
 
+      //move constructor
+      PHM(PHM &&);
+
       //destructor
       virtual ~PHM();
 
+      static int block_dim(int M,int i);
+
       void constr_lists();
 
       using BlockMatrix::operator=;
 
+      PHM &operator=(const PHM &) = default;
+
+      //move assignment
+      PHM &operator=(PHM &&);
+
       using BlockMatrix::operator();
 
       //change the numbers in sp mode
@@ -51,6 +66,9 @@ class PHM : public BlockMatrix {
       //change the numbers in sp mode: read mode
       double operator()(int S,int a,int b,int c,int d) const;
 
+      //sp mode access to the elements of a block, for the map kernels
+      static double sp(const double *block,int n,int a,int b,int c,int d);
+
       //geef N terug
       int gN() const;
 
@@ -59,6 +77,8 @@ class PHM : public BlockMatrix {
 
       void G(const TPM &);
 
+      void G(const SPM &,const TPM &);
+
       void uncouple(const char *filename);
 
       //trace the first pair of indices of a PPHM object
@@ -69,6 +89,9 @@ class PHM : public BlockMatrix {
 
    private:
 
+      template<int S>
+      void G_block(const SPM &,const TPM &);
+
       //!static counter that counts the number of PHM objects running in the program
       static int counter;
 
@@ -89,4 +112,20 @@ class PHM : public BlockMatrix {
 
 };
 
+/**
+ * access the elements of a block in sp mode, like PHM::operator()(S,a,b,c,d), but on the elements of the block directly
+ * @param block pointer to the elements of a block of a PHM (column major)
+ * @param n dimension of the block
+ * @param a first sp index that forms the ph row index i together with b
+ * @param b second sp index that forms the ph row index i together with a
+ * @param c first sp index that forms the ph column index j together with d
+ * @param d second sp index that forms the ph column index j together with c
+ * @return the number on place PHM(S,i,j)
+ */
+inline double PHM::sp(const double *block,int n,int a,int b,int c,int d){
+
+   return block[s2ph[a][b] + n*s2ph[c][d]];
+
+}
+
 #endif
@@ -8,6 +8,8 @@ using std::ostream;
 #include "BlockMatrix.h"
 #include "TPM.h"
 
+class SPM;
+
 /**
  * @author Brecht Verstichel
  * @date 03-05-2010\n\n
@@ -35,13 +37,23 @@ class PPHM : public BlockMatrix {
       //copy constructor
       PPHM(const PPHM &);
 
+      //move constructor
+      PPHM(PPHM &&);
+
       //destructor
       virtual ~PPHM();
 
+      static int block_dim(int M,int i);
+
       void construct_lists();
 
       using BlockMatrix::operator=;
 
+      PPHM &operator=(const PPHM &) = default;
+
+      //move assignment
+      PPHM &operator=(PPHM &&);
+
       using BlockMatrix::operator();
 
       //easy to access the numbers, in sp mode
@@ -58,6 +70,8 @@ class PPHM : public BlockMatrix {
       //maak een PPHM van een TPM via de T2 conditie
       void T(const TPM &);
 
+      void T(const SPM &,const TPM &);
+
       //input PPHM from file
       void in_sp(const char *);
 
@@ -51,6 +51,8 @@ using std::ostream;
 #endif
 
 class EIG;
+class LRSUP;
+class SepStats;
 
 /**
  * @author Brecht Verstichel
@@ -81,6 +83,9 @@ class SUP{
       //copy constructor
       SUP(const SUP &);
 
+      //move constructor
+      SUP(SUP &&);
+
       //destructor
       ~SUP();
 
@@ -93,6 +98,17 @@ class SUP{
       //overload equality operator
       SUP &operator=(const SUP &);
 
+      //move assignment
+      SUP &operator=(SUP &&);
+
+      //evaluate a linear combination
+      template<int K>
+      SUP &operator=(const LinComb<SUP,K> &lc){ return lincomb(K,lc.gcoef(),lc.gterm()); }
+
+      SUP &lincomb(int K,const double *coef,const SUP * const *term);
+
+      void swap(SUP &);
+
       //overload equality operator
       SUP &operator=(double );
 
@@ -182,7 +198,7 @@ class SUP{
 
 #endif
    
-      void sep_pm(SUP &p,SUP &m);
+      void proj_U_sep(SUP &Z,const TPM &rhs,const TPM &u,TPM &gamma,const LRSUP &X,double sigma,bool single,LRSUP *m_f,SepStats *stats,TPM &v);
 
    private:
 
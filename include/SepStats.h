@@ -0,0 +1,69 @@
+#ifndef SEPSTATS_H
+#define SEPSTATS_H
+
+#include <iostream>
+
+using std::ostream;
+
+#include "SUP.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * This class keeps track of how often every block of a SUP was positive or negative definite when it was separated in SUP::proj_U_sep,
+ * so that no eigendecomposition was needed, see Matrix::definite. A block of W that is always positive definite belongs to a condition
+ * that is inactive: the primal matrix is zero there.
+ */
+class SepStats{
+
+   /**
+    * Output stream operator overloaded: for every block the fraction of the calls to sep_pm in which it was positive and negative definite.
+    * @param output The stream to which you are writing (e.g. cout)
+    * @param stats_p the SepStats you want to print
+    */
+   friend ostream &operator<<(ostream &output,const SepStats &stats_p);
+
+   public:
+
+      //!number of parts: P, Q, G, T1 and T2
+      static const int n_part = 5;
+
+      //constructor
+      SepStats(const SUP &);
+
+      //copy constructor
+      SepStats(const SepStats &);
+
+      //destructor
+      virtual ~SepStats();
+
+      //overload equality operator
+      SepStats &operator=(const SepStats &);
+
+      long *counts(int part);
+
+      void tick();
+
+      long gcalls() const;
+
+      void reduce();
+
+   private:
+
+      void copy(const SepStats &);
+
+      //!the number of calls to sep_pm
+      long calls;
+
+      //!number of blocks in every part, 0 if the condition is not active
+      int nr[n_part];
+
+      //!dimensions of the blocks of every part
+      int *dim[n_part];
+
+      //!counts[part][2*i] is the number of times block i was positive definite, counts[part][2*i + 1] negative definite
+      long *n_def[n_part];
+
+};
+
+#endif
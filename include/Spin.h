@@ -0,0 +1,25 @@
+#ifndef SPIN_H
+#define SPIN_H
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * Compile time constants of a two particle spin block with spin S: the exchange symmetry and the 6j symbols that couple it to the
+ * other block. The map kernels are templates in S that are selected per block through a table of member pointers (see TPM::Q, PHM::G
+ * and TPM::G), so that the tests on S disappear from their inner loops. The values are the same as those in the _6j lists of TPM,
+ * PHM, DPM and PPHM.
+ */
+template<int S>
+class Spin{
+
+   public:
+
+      //!symmetric (S = 0) or antisymmetric (S = 1) in the sp indices
+      static constexpr int sign = 1 - 2*S;
+
+      //!the 6j symbols {1/2 1/2 S ; 1/2 1/2 Z} for Z = 0 and Z = 1
+      static constexpr double _6j[2] = { S == 0 ? -0.5 : 0.5 , S == 0 ? 0.5 : 1.0/6.0 };
+
+};
+
+#endif
@@ -12,6 +12,7 @@ class SUP;
 class PHM;
 class DPM;
 class PPHM;
+class SPM;
 
 /**
  * @author Brecht Verstichel
@@ -33,6 +34,9 @@ class TPM : public BlockMatrix {
     */
    friend ostream &operator<<(ostream &output,const TPM &tpm_p);
 
+   //the vector kernels use the lists
+   friend class MapStreams;
+
    public:
       
       //constructor
@@ -41,18 +45,32 @@ class TPM : public BlockMatrix {
       //copy constructor
       TPM(const TPM &);
 
+      //move constructor
+      TPM(TPM &&);
+
       //destructor
       virtual ~TPM();
 
+      static int block_dim(int M,int i);
+
       void constr_lists();
 
       using BlockMatrix::operator=;
 
+      TPM &operator=(const TPM &) = default;
+
+      //move assignment
+      TPM &operator=(TPM &&);
+
       using BlockMatrix::operator();
 
       //easy to access the numbers, in sp mode and with spin quantumnumer
       double operator()(int S,int a,int b,int c,int d) const;
 
+      //sp mode access to the elements of a block with the spin known at compile time, for the map kernels
+      template<int S>
+      static double sp(const double *block,int n,int a,int b,int c,int d);
+
       //geef N terug
       int gN() const;
 
@@ -67,6 +85,9 @@ class TPM : public BlockMatrix {
       //Q like afbeelding Q(A,B,C,tpm_d)
       void Q(int option,double A,double B,double C,const TPM &);
 
+      //Q like afbeelding met gegeven np en sp deel
+      void Q(double A,double ward,const SPM &,const TPM &);
+
       //overlapmatrix afbeelding en zijn inverse
       void S(int option,const TPM &);
 
@@ -105,6 +126,9 @@ class TPM : public BlockMatrix {
       //T2 down
       void T(const PPHM &);
 
+      //T2-like down map with given np, sp and ph part
+      void T(double ward,const TPM &,const SPM &,const PHM &);
+
       //return the spin
       double spin() const;
 
@@ -113,6 +137,12 @@ class TPM : public BlockMatrix {
 
    private:
 
+      template<int S>
+      void Q_block(double A,double ward,const SPM &,const TPM &);
+
+      template<int S>
+      void G_block(const SPM &,const PHM &);
+
       //!static list of dimension [2][dim[i]][2] that takes in a tp index i and a spinquantumnumber S, and returns two sp indices: a = t2s[S][i][0] and b = t2s[S][i][1]
       static int ***t2s;
 
@@ -133,4 +163,38 @@ class TPM : public BlockMatrix {
 
 };
 
+/**
+ * access the elements of block S in sp mode, like TPM::operator()(S,a,b,c,d), but on the elements of the block directly and with S
+ * a template parameter: the test on S is resolved at compile time.
+ * @param block pointer to the elements of block S of a TPM (column major)
+ * @param n dimension of block S
+ * @param a first sp index that forms the tp row index i of spin S, together with b
+ * @param b second sp index that forms the tp row index i of spin S, together with a
+ * @param c first sp index that forms the tp column index j of spin S, together with d
+ * @param d second sp index that forms the tp column index j of spin S, together with c
+ * @return the number on place TPM(S,i,j) with the right phase.
+ */
+template<int S>
+inline double TPM::sp(const double *block,int n,int a,int b,int c,int d){
+
+   if constexpr (S == 0)
+      return block[s2t[0][a][b] + n*s2t[0][c][d]];
+   else{
+
+      if( (a == b) || (c == d) )
+         return 0;
+
+      int phase = 1;
+
+      if(a > b)
+         phase *= -1;
+      if(c > d)
+         phase *= -1;
+
+      return phase*block[s2t[1][a][b] + n*s2t[1][c][d]];
+
+   }
+
+}
+
 #endif
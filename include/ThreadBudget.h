@@ -0,0 +1,77 @@
+#ifndef THREADBUDGET_H
+#define THREADBUDGET_H
+
+#include <iostream>
+
+#include "SUP.h"
+
+/**
+ * @author Brecht Verstichel
+ * @date 19-10-2026\n\n
+ * This class divides the threads between the tasks of the solver (see SUP::proj_U_sep) and the BLAS/LAPACK threads inside every task.
+ * A multithreaded BLAS that is called from concurrent tasks oversubscribes the cores, while the eigensolver of the largest block is on
+ * the critical path and should get most of them. Every block gets a number of BLAS threads proportional to its share of the n^3 work
+ * of all the blocks. The BLAS library is detected at runtime: OpenBLAS, MKL and BLIS can be controlled. MKL and OpenBLAS 0.3.27 or later
+ * set the number of threads per task (mkl_set_num_threads_local, openblas_set_num_threads_local). Older OpenBLAS versions and BLIS can
+ * only set it for the whole program: then the BLAS is single threaded in the concurrent tasks, and the blocks whose share is larger than
+ * one thread run alone, one after the other after the concurrent tasks, with their share set globally. An object of this class sets the
+ * BLAS threads for a block during its lifetime.
+ */
+class ThreadBudget{
+
+   public:
+
+      //constructor
+      ThreadBudget(int n);
+
+      //no copies: the destructor restores the BLAS threads
+      ThreadBudget(const ThreadBudget &) = delete;
+
+      ThreadBudget &operator=(const ThreadBudget &) = delete;
+
+      //destructor
+      virtual ~ThreadBudget();
+
+      static void init(int threads);
+
+      static void plan(const SUP &,int copies = 1);
+
+      static int gthreads();
+
+      static int blas_threads(int n);
+
+      static bool alone(int n);
+
+      static int global_threads();
+
+      static const char *blas_name();
+
+   private:
+
+      //!the number of BLAS threads before the object was constructed (of the task or of the whole program), 0 if they were not changed
+      int old;
+
+      //!total number of threads
+      static int threads;
+
+      //!sum of n^3 over all the blocks
+      static double work;
+
+      //!dimension of the largest block
+      static int n_max;
+
+      //!which library: 0 none (or not controllable), 1 OpenBLAS, 2 MKL, 3 BLIS
+      static int lib;
+
+      //!mkl_set_num_threads_local or openblas_set_num_threads_local, 0 if the library can't set the threads per task
+      static int (*set_local)(int);
+
+      //!number of SUP's that are separated concurrently, see plan
+      static int copies;
+
+      //!the number of BLAS threads that is set for the whole program
+      static int global;
+
+};
+
+#endif
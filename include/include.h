@@ -38,15 +38,28 @@
 #endif
 
 #include "lapack.h"
+#include "LinComb.h"
 #include "Matrix.h"
 #include "BlockMatrix.h"
+#include "LRMatrix.h"
+#include "LRBlockMatrix.h"
 #include "Vector.h"
 #include "BlockVector.h"
+#include "Spin.h"
 #include "TPM.h"
 #include "SPM.h"
 #include "PHM.h"
 #include "DPM.h"
 #include "PPHM.h"
+#include "DownMaps.h"
+#include "MapStreams.h"
 
 #include "SUP.h"
 #include "EIG.h"
+#include "LRSUP.h"
+#include "SepStats.h"
+#include "ThreadBudget.h"
+#include "Numa.h"
+#include "Distribution.h"
+#include "BoundaryPoint.h"
+#include "Estimate.h"
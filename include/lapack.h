@@ -12,13 +12,19 @@ extern "C" {
    void daxpy_(int *n,double *alpha,double *x,int *incx,double *y,int *incy);
    void dscal_(int *n,const double *alpha,double *x,int *incx);
    void dgemm_(char *transA,char *transB,int *m,int *n,int *k,double *alpha,double *A,int *lda,double *B,int *ldb,double *beta,double *C,int *ldc);
+   void dsyrk_(char *uplo,char *trans,int *n,int *k,double *alpha,double *A,int *lda,double *beta,double *C,int *ldc);
    void dsymm_(char *side,char *uplo,int *m,int *n,double *alpha,double *A,int *lda,double *B,int *ldb,double *beta,double *C,int *ldc);
    void dgemv_(char *trans,int *m,int *n,double *alpha,double *A,int *lda,double *x,int *incx,double *beta,double *y,int *incy);
    double ddot_(const int *n,double *x,int *incx,double *y,int *incy);
    void dsyev_(char *jobz,char *uplo,int *n,double *A,int *lda,double *W,double *work,int *lwork,int *info);
+   void dsyevd_(char *jobz,char *uplo,int *n,double *A,int *lda,double *W,double *work,int *lwork,int *iwork,int *liwork,int *info);
    void dpotrf_(char *uplo,int *n,double *A,int *lda,int *INFO);
    void dpotri_(char *uplo,int *n,double *A,int *lda,int *INFO);
 
+   //single precision routines for the mixed precision projections
+   void ssyevd_(char *jobz,char *uplo,int *n,float *A,int *lda,float *W,float *work,int *lwork,int *iwork,int *liwork,int *info);
+   void ssyrk_(char *uplo,char *trans,int *n,int *k,float *alpha,float *A,int *lda,float *beta,float *C,int *ldc);
+
 }
 
 #endif
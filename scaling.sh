@@ -0,0 +1,156 @@
+#!/bin/bash
+###############################################################################
+#
+#  End-to-end scaling benchmark of the boundary point method.
+#
+#  For every constraint set the program is rebuilt, then the full solver is run
+#  on a fixed catalogue of problems (hubbard chains at several fillings and
+#  interaction strengths, pairing models) for a number of thread counts. For
+#  every run the number of iterations, time per iteration, peak memory and
+#  final energy are recorded in a tab separated file. When a baseline file
+#  (an earlier output of this script) is given, runs that got slower, use more
+#  memory or converge to a different energy are flagged as regressions.
+#
+###############################################################################
+
+usage()
+{
+   cat <<EOF
+Usage: $0 [OPTIONS]
+
+    -c "PQ PQG ..."      Constraint sets to run (default: PQ PQG PQGT1 PQGT2 PQGT)
+    -m "8 12 ..."        Number of sp orbitals M (default: 8 12 16 20 24 28)
+    -t "1 2 4 ..."       Thread counts (default: 1 and the number of cores)
+    -o file              Output file (default: scaling_output.txt)
+    -b file              Baseline file to check for regressions
+    -r tolerance         Relative slowdown or memory growth flagged as regression (default: 0.1)
+    -h                   Display this help
+
+EOF
+}
+
+CONSTRAINTS="PQ PQG PQGT1 PQGT2 PQGT"
+SIZES="8 12 16 20 24 28"
+THREADS="1 $(nproc)"
+OUTPUT=scaling_output.txt
+BASELINE=
+TOLERANCE=0.1
+
+while getopts "c:m:t:o:b:r:h" opt; do
+   case $opt in
+      c) CONSTRAINTS="$OPTARG";;
+      m) SIZES="$OPTARG";;
+      t) THREADS="$OPTARG";;
+      o) OUTPUT="$OPTARG";;
+      b) BASELINE="$OPTARG";;
+      r) TOLERANCE="$OPTARG";;
+      *) usage; exit 0;;
+   esac
+done
+
+THREADS=$(echo $THREADS | tr ' ' '\n' | sort -n -u | tr '\n' ' ')
+
+# -----------------------------------------------------------------------------
+#   The problem catalogue: one line per problem, "model M N parameter"
+# -----------------------------------------------------------------------------
+catalogue()
+{
+   for M in $SIZES; do
+
+      # hubbard chains at quarter and half filling for weak, intermediate and strong coupling
+      for N in $((M/4)) $((M/2)); do
+         if [ $N -ge 2 ]; then
+            for U in 1 4 8; do
+               echo "hubbard $M $N $U"
+            done
+         fi
+      done
+
+      # pairing models at half filling
+      for g in 0.5 1.0; do
+         echo "pairing $M $((M/2)) $g"
+      done
+
+   done
+}
+
+# -----------------------------------------------------------------------------
+#   Field n of the last line of the solver output that starts with label
+# -----------------------------------------------------------------------------
+report()
+{
+   echo "$1" | awk -v label="$2" -v n=$3 'index($0,label) == 1 { value = $n } END { print value }'
+}
+
+echo -e "#constraints\tmodel\tM\tN\tparameter\tthreads\titerations\ttime/iteration(s)\ttime(s)\tpeak memory(kB)\tenergy" > $OUTPUT
+
+for cons in $CONSTRAINTS; do
+
+   echo "  +++ Building spin_bp with $cons"
+
+   make clean > /dev/null
+   make $cons > /dev/null || { echo "  +++ Building with $cons failed!"; exit 1; }
+
+   mv spin_bp spin_bp_$cons
+
+   catalogue | while read model M N par; do
+
+      for t in $THREADS; do
+
+         if [ $model == "hubbard" ]; then
+            args="-m $M -n $N -U $par"
+         else
+            args="-m $M -n $N -g $par"
+         fi
+
+         log=$(OMP_NUM_THREADS=$t OPENBLAS_NUM_THREADS=$t ./spin_bp_$cons $args)
+
+         # the results are found by their labels, the reports around them can change
+         iter=$(report "$log" "iterations:" 2)
+         tpi=$(report "$log" "time per iteration:" 4)
+         tot=$(report "$log" "time:" 2)
+         mem=$(report "$log" "peak memory:" 3)
+         energy=$(report "$log" "Energy:" 2)
+
+         echo -e "$cons\t$model\t$M\t$N\t$par\t$t\t$iter\t$tpi\t$tot\t$mem\t$energy" | tee -a $OUTPUT
+
+      done
+
+   done
+
+   rm -f spin_bp_$cons
+
+done
+
+make clean > /dev/null
+
+# -----------------------------------------------------------------------------
+#   Compare with the baseline
+# -----------------------------------------------------------------------------
+if [ -n "$BASELINE" ]; then
+
+   awk -v tol=$TOLERANCE -F '\t' '
+      /^#/ { next }
+      FNR == NR { key = $1 FS $2 FS $3 FS $4 FS $5 FS $6; tpi[key] = $8; mem[key] = $10; energy[key] = $11; next }
+      {
+         key = $1 FS $2 FS $3 FS $4 FS $5 FS $6
+         if(!(key in tpi))
+            next
+         if($8 > (1.0 + tol) * tpi[key])
+            { print "REGRESSION (time): " key "\t" tpi[key] " -> " $8; bad = 1 }
+         if($10 > (1.0 + tol) * mem[key])
+            { print "REGRESSION (memory): " key "\t" mem[key] " -> " $10; bad = 1 }
+         d = $11 - energy[key]
+         if(d > 1.0e-5 || d < -1.0e-5)
+            { print "REGRESSION (energy): " key "\t" energy[key] " -> " $11; bad = 1 }
+      }
+      END { exit bad }' $BASELINE $OUTPUT
+
+   if [ $? -ne 0 ]; then
+      echo "  +++ Regressions found with respect to $BASELINE!"
+      exit 1
+   fi
+
+   echo "  +++ No regressions with respect to $BASELINE."
+
+fi
@@ -11,13 +11,183 @@
 #include <fstream>
 #include <cmath>
 #include <getopt.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <vector>
+#include <string>
 
 using std::cout;
 using std::endl;
 using std::ofstream;
+using std::vector;
+using std::string;
 
 #include "include.h"
 
+/**
+ * Solve many small problems with the same number of sites concurrently: a window of instances is active, every sweep does one outer
+ * iteration of each of them as a task, so the small blocks of all the instances fill the threads together. This only schedules the
+ * instances side by side, the eigensolves are not batched: every block is still diagonalized by its own LAPACK call, with one BLAS
+ * thread (see ThreadBudget::plan). An instance is retired when it has converged, when it has diverged or after max_iter outer
+ * iterations, and replaced by the next one from the file. The blocks of all the instances have the same dimensions, the index lists
+ * are shared.
+ * @param file every line is "hubbard N U" or "pairing N g"
+ * @param M dimension of the sp space for all the instances
+ * @param lowrank see BoundaryPoint
+ * @param single see BoundaryPoint
+ * @param window number of instances that are solved at the same time, 0 for twice the number of threads
+ * @param max_iter maximal number of outer iterations of an instance
+ * @return 0 if all the instances converged, the exit code of spin_bp otherwise
+ */
+int solve_batch(const char *file,int M,double lowrank,double single,int window,int max_iter){
+
+   std::ifstream input(file);
+
+   if(!input){
+
+      std::cerr << "Cannot open batch file " << file << endl;
+      return -5;
+
+   }
+
+   vector<bool> pairing;
+   vector<int> N;
+   vector<double> par;
+
+   string kind;
+   int n;
+   double x;
+
+   while(input >> kind >> n >> x){
+
+      //the maps divide by N - 1
+      if( (kind != "hubbard" && kind != "pairing") || n < 2 || n > M)
+      {
+         std::cerr << "Invalid instance in batch file: " << kind << " " << n << " " << x << endl;
+         return -5;
+      }
+
+      pairing.push_back(kind == "pairing");
+      N.push_back(n);
+      par.push_back(x);
+
+   }
+
+   int n_inst = N.size();
+
+   if(n_inst == 0)
+      return 0;
+
+   if(window <= 0)
+      window = 2*ThreadBudget::gthreads();
+
+   if(window > n_inst)
+      window = n_inst;
+
+   cout << "Batch of " << n_inst << " instances with M=" << M << ", " << window << " at the same time, at most " << max_iter << " iterations each" << endl;
+
+   timespec start,end;
+
+   clock_gettime(CLOCK_MONOTONIC,&start);
+
+   //keeps the index lists alive while the instances come and go, and gives the shape of the blocks to the thread budget
+   SUP shape(M,N[0]);
+
+   ThreadBudget::plan(shape,window);
+
+   vector<BoundaryPoint *> active(window,(BoundaryPoint *)0);
+   vector<int> index(window,-1);
+
+   vector<double> energy(n_inst);
+   vector<int> iterations(n_inst);
+   vector<const char *> status(n_inst);
+
+   int next = 0;
+   int done = 0;
+
+   #pragma omp parallel proc_bind(spread)
+   #pragma omp single
+   while(done < n_inst){
+
+      for(int k = 0;k < window;++k)
+         if(active[k] == 0 && next < n_inst){
+
+            TPM ham(M,N[next]);
+
+            if(pairing[next])
+               ham.sp_pairing(par[next]);
+            else
+               ham.hubbard(par[next]);
+
+            active[k] = new BoundaryPoint(ham,lowrank,single);
+            index[k] = next;
+
+            ++next;
+
+         }
+
+      //every outer iteration is a task, its projection spawns the tasks of the blocks
+      #pragma omp taskloop shared(active) grainsize(1)
+      for(int k = 0;k < window;++k)
+         if(active[k] != 0)
+            active[k]->outer();
+
+      for(int k = 0;k < window;++k)
+         if(active[k] != 0 && (active[k]->converged() || active[k]->diverged() || active[k]->giter() >= max_iter)){
+
+            energy[index[k]] = active[k]->energy();
+            iterations[index[k]] = active[k]->giter();
+
+            if(active[k]->converged())
+               status[index[k]] = "converged";
+            else if(active[k]->diverged())
+               status[index[k]] = "diverged";
+            else
+               status[index[k]] = "not converged";
+
+            delete active[k];
+            active[k] = 0;
+
+            ++done;
+
+         }
+
+   }
+
+   clock_gettime(CLOCK_MONOTONIC,&end);
+
+   double time = (end.tv_sec - start.tv_sec) + 1.0e-9 * (end.tv_nsec - start.tv_nsec);
+
+   cout << endl;
+
+   int failed = 0;
+
+   for(int i = 0;i < n_inst;++i){
+
+      cout << (pairing[i] ? "pairing" : "hubbard") << "\t" << N[i] << "\t" << par[i] << "\t" << energy[i] << "\t" << iterations[i] << "\t" << status[i] << endl;
+
+      if(status[i][0] != 'c')
+         ++failed;
+
+   }
+
+   cout << endl;
+   cout << "time: " << time << " s" << endl;
+   cout << "solves per second: " << n_inst/time << endl;
+   cout << "threads: " << ThreadBudget::gthreads() << " (BLAS: " << ThreadBudget::blas_name() << ", maps: " << MapStreams::isa_name() << ")" << endl;
+
+   if(failed > 0){
+
+      std::cerr << failed << " of the " << n_inst << " instances did not converge" << endl;
+
+      return -8;
+
+   }
+
+   return 0;
+
+}
+
 /**
  * 
  * In the main the actual program is run.\n 
@@ -31,18 +201,48 @@ int main(int argc,char **argv)
    int M = 8;//dim sp hilbert space
    int N = 4;//nr of particles
    double U = 1;//onsite interaction strength
+   double g = 0;//pairing strength
+   bool pairing = false;//hubbard or pairing hamiltonian
+   double single = 0.0;//single precision projections as long as the residuals are larger than this
+   double lowrank = 0.0;//blocks of the primal matrix with rank up to this fraction of their dimension are stored factored
+   bool definite = false;//print how often the blocks of W were definite
+   int ooc_dim = 0;//blocks with this dimension or larger are stored in memory mapped files
+   const char *ooc_dir = "/tmp";//directory for the memory mapped files
+   bool dry_run = false;//only estimate memory and time
+   int threads = 0;//number of threads, 0 for the OpenMP default
+   bool numa = false;//distribute the blocks over the NUMA nodes and report the placement
+   const char *batch = 0;//file with the instances for the batch mode
+   int window = 0;//number of instances in the batch that are solved at the same time
+   int max_iter = 100000;//maximal number of outer iterations
+   const char *cache = 0;//directory for the cache files of the map streams
 
    struct option long_options[] =
    {
       {"particles",  required_argument, 0, 'n'},
       {"sites",  required_argument, 0, 'm'},
       {"interaction", required_argument, 0, 'U'},
+      {"pairing", required_argument, 0, 'g'},
+      {"single", required_argument, 0, 's'},
+      {"sign", required_argument, 0, 'S'},
+      {"eig", required_argument, 0, 'E'},
+      {"lowrank", required_argument, 0, 'l'},
+      {"definite", no_argument, 0, 'd'},
+      {"out-of-core", required_argument, 0, 'o'},
+      {"out-of-core-dir", required_argument, 0, 'D'},
+      {"dry-run", no_argument, 0, 'r'},
+      {"threads", required_argument, 0, 't'},
+      {"numa", no_argument, 0, 'a'},
+      {"batch", required_argument, 0, 'b'},
+      {"window", required_argument, 0, 'B'},
+      {"iterations", required_argument, 0, 'I'},
+      {"isa", required_argument, 0, 'i'},
+      {"cache", required_argument, 0, 'c'},
       {"help",  no_argument, 0, 'h'},
       {0, 0, 0, 0}
    };
 
    int i,j;
-   while( (j = getopt_long (argc, argv, "hn:m:U:", long_options, &i)) != -1)
+   while( (j = getopt_long (argc, argv, "hn:m:U:g:s:S:E:l:do:D:rt:ab:B:I:i:c:", long_options, &i)) != -1)
       switch(j)
       {
          case 'h':
@@ -52,15 +252,32 @@ int main(int argc,char **argv)
                "    -n, --particles=particles    Set the number of particles\n"
                "    -m, --sites=sites            Set the number of sites\n"
                "    -U, --interaction=U          Set the interaction strength\n"
+               "    -g, --pairing=g              Use the pairing hamiltonian with pairing strength g\n"
+               "    -s, --single=threshold       Project in single precision until the residuals drop below threshold or stop decreasing\n"
+               "    -S, --sign=dim               Project blocks of dimension dim and larger with the Newton-Schulz sign iteration\n"
+               "    -E, --eig=dim                Diagonalize blocks of dimension dim and larger with the parallel eigensolver (default 100, 0 never)\n"
+               "    -l, --lowrank=fraction       Store primal blocks with rank up to fraction times their dimension in factored form\n"
+               "    -d, --definite               Print how often every block was definite and needed no eigendecomposition\n"
+               "    -o, --out-of-core=dim        Store blocks of dimension dim and larger in memory mapped files\n"
+               "    -D, --out-of-core-dir=dir    Directory for the memory mapped files (default /tmp)\n"
+               "    -r, --dry-run                Estimate the memory use and the time per iteration and exit\n"
+               "    -t, --threads=threads        Number of threads, divided between the blocks and the BLAS (default OMP_NUM_THREADS)\n"
+               "    -a, --numa                   Distribute the blocks over the NUMA nodes and print the placement\n"
+               "    -b, --batch=file             Solve all the instances in file (lines \"hubbard N U\" or \"pairing N g\") with M sites concurrently\n"
+               "    -B, --window=instances       Number of instances of the batch that are solved at the same time (default 2 x threads)\n"
+               "    -I, --iterations=iterations  Stop after this many outer iterations, in the batch mode per instance (default 100000)\n"
+               "    -i, --isa=name               Instruction set of the map kernels: scalar, avx2, avx512 or auto (default)\n"
+               "    -c, --cache=dir              Keep the streams of the map kernels in files in dir, shared by later runs\n"
                "    -h, --help                   Display this help\n"
                "\n";
             return 0;
             break;
          case 'n':
             N = atoi(optarg);
-            if( N <= 0)
+            //the maps divide by N - 1
+            if( N < 2)
             {
-               std::cerr << "Invalid particle number!" << endl;
+               std::cerr << "Invalid particle number, at least 2 particles are needed!" << endl;
                return -1;
             }
             break;
@@ -75,138 +292,217 @@ int main(int argc,char **argv)
          case 'U':
             U = atof(optarg);
             break;
+         case 'g':
+            g = atof(optarg);
+            pairing = true;
+            break;
+         case 's':
+            single = atof(optarg);
+            break;
+         case 'S':
+            Matrix::set_sign_dim(atoi(optarg));
+            break;
+         case 'E':
+            Matrix::set_eig_dim(atoi(optarg));
+            break;
+         case 'l':
+            lowrank = atof(optarg);
+            if( lowrank < 0.0 || lowrank > 1.0)
+            {
+               std::cerr << "Invalid low rank fraction!" << endl;
+               return -3;
+            }
+            break;
+         case 'd':
+            definite = true;
+            break;
+         case 'o':
+            ooc_dim = atoi(optarg);
+            break;
+         case 'D':
+            ooc_dir = optarg;
+            break;
+         case 'r':
+            dry_run = true;
+            break;
+         case 't':
+            threads = atoi(optarg);
+            break;
+         case 'a':
+            numa = true;
+            break;
+         case 'b':
+            batch = optarg;
+            break;
+         case 'B':
+            window = atoi(optarg);
+            break;
+         case 'I':
+            max_iter = atoi(optarg);
+            if( max_iter <= 0)
+            {
+               std::cerr << "Invalid number of iterations!" << endl;
+               return -7;
+            }
+            break;
+         case 'i':
+            if(!MapStreams::set_isa(optarg))
+            {
+               std::cerr << "Instruction set " << optarg << " is unknown or not supported!" << endl;
+               return -6;
+            }
+            break;
+         case 'c':
+            cache = optarg;
+            break;
       }
 
-   cout << "Starting with M=" << M << " N=" << N << " U=" << U << endl;
+   ThreadBudget::init(threads);
 
-   //hamiltoniaan
-   TPM ham(M,N);
-   ham.hubbard(U);
+   if(dry_run){
+
+      cout << "Dry run with M=" << M << " N=" << N << endl;
+      cout << endl;
 
-   TPM ham_copy(ham);
+      Estimate est(M,N,(single > 0.0),ooc_dim);
 
-   //only traceless hamiltonian needed in program.
-   ham.proj_Tr();
+      est.calibrate();
 
-   //primal
-   SUP X(M,N);
+      cout << est;
 
-   //dual
-   SUP Z(M,N);
+      return 0;
 
-   //Lagrange multiplier
-   SUP V(M,N);
+   }
 
-   //just dubya
-   SUP W(M,N);
+   Distribution::init(&argc,&argv);
 
-   SUP u_0(M,N);
+   //only rank 0 prints
+   if(Distribution::grank() != 0)
+      cout.setstate(std::ios_base::badbit);
 
-   //little help
-   TPM hulp(M,N);
+   Matrix::set_mmap(ooc_dim,ooc_dir);
 
-   u_0.tpm(0).init();
+   MapStreams::set_cache(cache);
 
-   u_0.fill();
+   if(batch != 0){
 
-   X = 0.0;
-   Z = 0.0;
+      //the instances are small: they are not distributed
+      if(Distribution::gsize() > 1){
 
-   //what does this do?
-   double sigma = 1.0;
+         std::cerr << "The batch mode runs on a single rank!" << endl;
 
-   double tolerance = 1.0e-7;
+         Distribution::finalize();
 
-   double D_conv(1.0),P_conv(1.0),convergence(1.0);
+         return -4;
 
-   // mazziotti uses 1.6 for this
-   double mazzy = 1.6;
+      }
 
-   int iter_dual,iter_primal(0);
-   int max_iter = 1;
+      int ret = solve_batch(batch,M,lowrank,single,window,max_iter);
 
-   while(P_conv > tolerance || D_conv > tolerance || fabs(convergence) > tolerance){
+      Distribution::finalize();
 
-      ++iter_primal;
+      return ret;
 
-      D_conv = 1.0;
+   }
 
-      iter_dual = 0;
+   if(pairing)
+      cout << "Starting with M=" << M << " N=" << N << " g=" << g << endl;
+   else
+      cout << "Starting with M=" << M << " N=" << N << " U=" << U << endl;
 
-      while(D_conv > tolerance  && iter_dual <= max_iter)
-      {
+   timespec start,end;
 
-         ++iter_dual;
+   clock_gettime(CLOCK_MONOTONIC,&start);
 
-         //solve system
-         SUP B(Z);
+   //hamiltoniaan
+   TPM ham(M,N);
 
-         B -= u_0;
+   if(pairing)
+      ham.sp_pairing(g);
+   else
+      ham.hubbard(U);
 
-         B.daxpy(mazzy/sigma,X);
+   //Z, W and the primal X with the parameters of the method
+   BoundaryPoint bp(ham,lowrank,single);
 
-         TPM b(M,N);
+   //with MPI every rank keeps only its own blocks of Z and W
+   Distribution::distribute(bp.gZ(),bp.gW());
 
-         b.collaps(1,B);
+   if(Distribution::gsize() > 1)
+      Distribution::report(cout);
 
-         b.daxpy(-mazzy/sigma,ham);
+   //divide the threads between the blocks of W and the BLAS
+   ThreadBudget::plan(bp.gW());
 
-         hulp.S(-1,b);
+   //bind the blocks of Z and W to the NUMA nodes, the dense blocks of X follow those of W (see LRMatrix::update)
+   if(numa)
+      Numa::place(bp.gZ(),bp.gW());
 
-         //hulp is the matrix containing the gamma_i's
-         hulp.proj_Tr();
+   //the iterations are run by one thread, the others execute the tasks of the maps and the eigensolvers. The threads are created
+   //once for the whole run and spread over the cores, they wait for tasks between the iterations.
+   #pragma omp parallel proc_bind(spread)
+   #pragma omp single
+   while(!bp.converged() && !bp.diverged() && bp.giter() < max_iter){
 
-         //construct W
-         W.fill(hulp);
+      bool was_single = bp.gsingle();
 
-         W += u_0;
+      bp.outer();
 
-         W.daxpy(-1.0/sigma,X);
+      if(was_single && !bp.gsingle())
+         cout << "switching to double precision projections" << endl;
 
-         //update Z and V with eigenvalue decomposition:
-         W.sep_pm(Z,V);
+      cout << bp.gP_conv() << "\t" << bp.gD_conv() << "\t" << bp.gsigma() << "\t" << bp.gconvergence() << "\t" << bp.energy() << endl;
 
-         V.dscal(-sigma);
+   }
 
-         //check infeasibility of the primal problem:
-         TPM v(M,N);
+   cout << endl;
+   cout << "Energy: " << bp.energy() << endl;
+   cout << "pd gap: " << bp.pd_gap() << endl;
+   cout << "dual conv: " << bp.gD_conv() << endl;
+   cout << "primal conv: " << bp.gP_conv() << endl;
 
-         v.collaps(1,V);
+   if(bp.diverged())
+      cout << "diverged after " << bp.giter() << " iterations" << endl;
+   else if(!bp.converged())
+      cout << "not converged after " << bp.giter() << " iterations" << endl;
 
-         v -= ham;
+   clock_gettime(CLOCK_MONOTONIC,&end);
 
-         D_conv = sqrt(v.ddot(v));
+   double time = (end.tv_sec - start.tv_sec) + 1.0e-9 * (end.tv_nsec - start.tv_nsec);
 
-     }
+   rusage usage;
+   getrusage(RUSAGE_SELF,&usage);
 
-      //update primal:
-      X = V;
+   cout << "iterations: " << bp.giter() << endl;
+   cout << "time: " << time << " s" << endl;
+   cout << "time per iteration: " << time/bp.giter() << " s" << endl;
+   cout << "peak memory: " << usage.ru_maxrss << " kB" << endl;
+   cout << "threads: " << ThreadBudget::gthreads() << " (BLAS: " << ThreadBudget::blas_name() << ", maps: " << MapStreams::isa_name() << ")" << endl;
 
-      //check dual feasibility (W is a helping variable now)
-      W.fill(hulp);
+   if(lowrank > 0.0)
+      cout << "primal storage: " << Distribution::sum(bp.gX().memory())*sizeof(double)/1024 << " kB" << endl;
 
-      W += u_0;
+   if(numa){
 
-      W -= Z;
+      cout << endl;
+      cout << "NUMA placement of the blocks of W on " << Numa::nodes() << " node(s):" << endl;
+      Numa::report(cout,bp.gW());
+      Numa::report_threads(cout);
+      Numa::check(cout,bp.gZ(),bp.gW(),bp.gX());
 
-      P_conv = sqrt(W.ddot(W));
+   }
 
-      if(D_conv < P_conv)
-         sigma *= 1.01;
-      else
-         sigma /= 1.01;
+   if(definite){
 
-      convergence = ham.ddot(Z.tpm(0)) + u_0.ddot(X);
+      bp.gstats().reduce();
 
-      cout << P_conv << "\t" << D_conv << "\t" << sigma << "\t" << convergence << "\t" << ham_copy.ddot(Z.tpm(0)) << endl;
+      cout << endl;
+      cout << "fraction of the projections in which the blocks of W were definite:" << endl;
+      cout << bp.gstats();
 
    }
 
-   cout << endl;
-   cout << "Energy: " << ham_copy.ddot(Z.tpm(0)) << endl;
-   cout << "pd gap: " << Z.ddot(X) << endl;
-   cout << "dual conv: " << D_conv << endl;
-   cout << "primal conv: " << P_conv << endl;
+   Distribution::finalize();
 
    return 0;
 